@@ -0,0 +1,40 @@
+#include "Animation.hpp"
+
+namespace VRThreads
+{
+	Animation::Animation(shared_ptr<MeshSequence> sequence, float timeInterval, bool loop)
+		: m_sequence(sequence), m_timeInterval(timeInterval), m_loop(loop)
+	{
+		SET_COMPONENT_NAME;
+
+		const auto& first = m_sequence->firstFrame();
+		m_mesh = make_shared<Mesh>(first.positions, first.normals, first.texCoords, first.indices);
+		m_positions = first.positions.data();
+	}
+
+	void Animation::Start()
+	{
+		m_sequence->Prefetch(0);
+	}
+
+	void Animation::Progress(float time)
+	{
+		int numFrames = m_sequence->numFrames();
+		if (numFrames == 0 || m_timeInterval <= 0) return;
+
+		int frame = max(0, (int)(time / m_timeInterval));
+		frame = m_loop ? frame % numFrames : min(frame, numFrames - 1);
+		m_sequence->Prefetch(frame);
+		if (frame == m_frame) return;
+
+		// a frame that isn't decoded yet is skipped, the mesh keeps the last shown frame
+		const glm::vec3* positions;
+		const glm::vec3* normals;
+		if (m_sequence->GetFrame(frame, positions, normals))
+		{
+			m_mesh->SetVerticesAndNormals(positions, normals, m_mesh->vertices().size());
+			m_frame = frame;
+			m_positions = positions;
+		}
+	}
+}
\ No newline at end of file
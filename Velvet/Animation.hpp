@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+
+#include "Component.hpp"
+#include "Mesh.hpp"
+#include "MeshSequence.hpp"
+
+namespace VRThreads
+{
+	/// <summary>
+	/// Plays a mesh sequence on one mesh, which is created from the first frame and updated in place.
+	/// Pass getMesh() to the MeshRenderer of the actor and drive playback with Actor::Progress(time).
+	/// </summary>
+	class Animation : public Component
+	{
+	public:
+		// timeInterval is the time between two frames in seconds
+		Animation(shared_ptr<MeshSequence> sequence, float timeInterval, bool loop = true);
+
+		void Start() override;
+
+		void Progress(float time) override;
+
+		shared_ptr<Mesh> getMesh() const
+		{
+			return m_mesh;
+		}
+
+		int frame() const
+		{
+			return m_frame;
+		}
+
+		int numFrames() const
+		{
+			return m_sequence->numFrames();
+		}
+
+		// Vertices of the shown frame in the local space of the actor, valid until the next Progress
+		const glm::vec3* positions() const
+		{
+			return m_positions;
+		}
+
+	private:
+		shared_ptr<MeshSequence> m_sequence;
+		shared_ptr<Mesh> m_mesh;
+		float m_timeInterval;
+		bool m_loop;
+		int m_frame = 0;
+		const glm::vec3* m_positions = nullptr;
+	};
+}
\ No newline at end of file
@@ -24,14 +24,19 @@ in VS {
     vec3 farPoint;
 } vs;
 
-uniform mat4 _View;
-uniform mat4 _Projection;
-uniform mat4 _WorldToLight;
+// camera and light data shared by all materials, written once per frame (FrameUniforms.hpp)
+layout(std140) uniform FrameUniforms
+{
+	mat4 _View;
+	mat4 _Projection;
+	mat4 _InvView;
+	mat4 _WorldToLight;
+	vec3 _CameraPos;
+	SpotLight spotLight;
+};
 
-uniform vec3 _CameraPos;
 uniform vec4 _Plane;
 uniform sampler2D _ShadowTex;
-uniform SpotLight spotLight;
 uniform Material material;
 
 out vec4 FragColor;
@@ -1,8 +1,33 @@
 #version 330
 layout(location = 0) in vec3 aPos;
+
+struct SpotLight {
+	vec3 position;
+	vec3 direction;
+	float cutOff;
+	float outerCutOff;
+
+	float constant;
+	float linear;
+	float quadratic;
+
+    vec3 color;
+    float ambient;
+};
+
+// camera and light data shared by all materials, written once per frame (FrameUniforms.hpp)
+layout(std140) uniform FrameUniforms
+{
+	mat4 _View;
+	mat4 _Projection;
+	mat4 _InvView;
+	mat4 _WorldToLight;
+	vec3 _CameraPos;
+	SpotLight spotLight;
+};
+
 uniform mat4 _Model;
-uniform mat4 _View;
-uniform mat4 _Projection;
+
 void main()
 {
 	gl_Position = _Projection * _View * _Model * vec4(aPos, 1.0);
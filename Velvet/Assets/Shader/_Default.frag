@@ -30,9 +30,18 @@ in VS {
 	vec4 lightSpaceFragPos;
 } vs;
 
-uniform vec3 _CameraPos;
+// camera and light data shared by all materials, written once per frame (FrameUniforms.hpp)
+layout(std140) uniform FrameUniforms
+{
+	mat4 _View;
+	mat4 _Projection;
+	mat4 _InvView;
+	mat4 _WorldToLight;
+	vec3 _CameraPos;
+	SpotLight spotLight;
+};
+
 uniform sampler2D _ShadowTex;
-uniform SpotLight spotLight;
 uniform Material material;
 
 out vec4 FragColor;
@@ -12,10 +12,32 @@ out VS {
 	vec4 lightSpaceFragPos;
 } vs;
 
+struct SpotLight {
+	vec3 position;
+	vec3 direction;
+	float cutOff;
+	float outerCutOff;
+
+	float constant;
+	float linear;
+	float quadratic;
+
+    vec3 color;
+    float ambient;
+};
+
+// camera and light data shared by all materials, written once per frame (FrameUniforms.hpp)
+layout(std140) uniform FrameUniforms
+{
+	mat4 _View;
+	mat4 _Projection;
+	mat4 _InvView;
+	mat4 _WorldToLight;
+	vec3 _CameraPos;
+	SpotLight spotLight;
+};
+
 uniform mat4 _Model;
-uniform mat4 _View;
-uniform mat4 _Projection;
-uniform mat4 _WorldToLight;
 uniform float _ParticleRadius;
 
 void main()
@@ -29,16 +29,21 @@ in GS {
     vec3 centerEyePos;
 } gs;
 
-uniform mat4 _View;
-uniform mat4 _Projection;
-uniform mat4 _InvView;
-uniform mat4 _WorldToLight;
+// camera and light data shared by all materials, written once per frame (FrameUniforms.hpp)
+layout(std140) uniform FrameUniforms
+{
+	mat4 _View;
+	mat4 _Projection;
+	mat4 _InvView;
+	mat4 _WorldToLight;
+	vec3 _CameraPos;
+	SpotLight spotLight;
+};
+
 uniform float _ParticleRadius;
 // Special End ====
 
-uniform vec3 _CameraPos;
 uniform sampler2D _ShadowTex;
-uniform SpotLight spotLight;
 uniform Material material;
 
 out vec4 FragColor;
@@ -40,10 +40,22 @@ namespace VRThreads
 			curTransform = actor->transform->matrix();
 		}
 
-		virtual glm::vec3 ComputeSDF(glm::vec3 position)
+		// Snapshot of this collider for the solvers
+		virtual SDFCollider GetSDFCollider() const
 		{
-			// TODO OH: compute SDF for general mesh collider
+			SDFCollider sc;
+			sc.type = type;
+			sc.position = actor->transform->position;
+			sc.scale = actor->transform->scale;
+			sc.curTransform = curTransform;
+			sc.invCurTransform = glm::inverse(curTransform);
+			sc.lastTransform = lastTransform;
+			sc.deltaTime = Timer::fixedDeltaTime();
+			return sc;
+		}
 
+		virtual glm::vec3 ComputeSDF(glm::vec3 position)
+		{
 			if (type == ColliderType::Plane)
 			{
 				return ComputePlaneSDF(position);
@@ -52,6 +64,8 @@ namespace VRThreads
 			{
 				return ComputeSphereSDF(position);
 			}
+			// other shapes (e.g. MeshCollider) are evaluated like the solvers do
+			return GetSDFCollider().ComputeSDF(position, Global::simParams.collisionMargin);
 		}
 
 		virtual glm::vec3 ComputePlaneSDF(glm::vec3 position)
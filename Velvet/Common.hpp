@@ -4,6 +4,8 @@
 #include <imgui.h>
 #include <functional>
 #include <vector>
+#include <cmath>
+#include <cfloat>
 
 #define IMGUI_LEFT_LABEL(func, label, ...) (ImGui::TextUnformatted(label), ImGui::SameLine(), func("##" label, __VA_ARGS__))
 
@@ -16,6 +18,13 @@
 	#define HOST_INIT(val) = val
 #endif
 
+// Functions shared by the CUDA kernels and the CPU solver
+#ifdef __CUDACC__
+	#define HOST_DEVICE __host__ __device__
+#else
+	#define HOST_DEVICE
+#endif
+
 struct VtSimParams
 {
 	int numSubsteps					HOST_INIT(2);
@@ -44,6 +53,9 @@ struct VtSimParams
 	// misc
 	float particleDiameterScalar	HOST_INIT(1.5f);					//!< multiply original stretch length by this scalar to obtain particle diameter
 	float hashCellSizeScalar		HOST_INIT(1.5f);					//!< multiply particle diameter by this scalar to obtain hash cell size
+	int numCpuThreads				HOST_INIT(0);						//!< Worker threads used by the CPU solver, 0 uses all hardware threads
+	bool enableJacobiCPU			HOST_INIT(false);					//!< CPU solver accumulates constraint deltas like the GPU solver instead of solving in place (Gauss-Seidel)
+	float normalUpdateDistance		HOST_INIT(-1.0f);					//!< Negative recomputes normals every frame. Otherwise they are recomputed once a particle moved further than this since the last update, which costs a displacement reduction per frame
 
 	// future updates
 	//float wind[3];													//!< Constant acceleration applied to particles that belong to dynamic triangles, drag needs to be > 0 for wind to affect triangles
@@ -76,6 +88,7 @@ struct VtGameState
 	bool drawParticles = false;
 	bool hideGUI = false;
 	bool detailTimer = false;
+	bool bakeCache = false;
 };
 
 template <class T, class... TArgs>
@@ -115,4 +128,392 @@ enum class ColliderType
 	Sphere,
 	Plane,
 	Cube,
+	Mesh,
+	DynamicMesh,
+};
+
+// Sparse narrow band distance field of a mesh collider, baked by MeshSDF (see MeshSDF.hpp).
+// Space is split into bricks of k_brickCells^3 voxels. Bricks near the surface store the signed distances at their
+// k_brickNodes^3 voxel corners, so a sample only reads one brick. Empty bricks are farther than bandWidth.
+struct SDFGridView
+{
+	static constexpr int k_brickCells = 7;
+	static constexpr int k_brickNodes = k_brickCells + 1;
+
+	glm::vec3 origin;
+	float voxelSize;
+	glm::ivec3 numBricks;
+	float bandWidth;
+	const int* bricks;				//!< Index into distances of each brick (x fastest), -1 for empty bricks
+	const float* distances;			//!< k_brickNodes^3 distances per brick (x fastest), negative inside
+
+	// Trilinear distance at position. gradient is the derivative of the interpolation, zero outside of the band.
+	HOST_DEVICE float Sample(const glm::vec3 position, glm::vec3& gradient) const
+	{
+		gradient = glm::vec3(0);
+		glm::vec3 cell = (position - origin) / voxelSize;
+		glm::vec3 extent = glm::vec3(numBricks * k_brickCells);
+		if (!(cell.x >= 0 && cell.y >= 0 && cell.z >= 0 && cell.x < extent.x && cell.y < extent.y && cell.z < extent.z))
+		{
+			return bandWidth;
+		}
+
+		glm::ivec3 voxel = glm::ivec3(cell);
+		glm::ivec3 brickCoord = voxel / k_brickCells;
+		int brick = bricks[(brickCoord.z * numBricks.y + brickCoord.y) * numBricks.x + brickCoord.x];
+		if (brick < 0)
+		{
+			return bandWidth;
+		}
+
+		glm::ivec3 node = voxel - brickCoord * k_brickCells;
+		glm::vec3 t = cell - glm::vec3(voxel);
+		const int dy = k_brickNodes;
+		const int dz = k_brickNodes * k_brickNodes;
+		const float* d = distances + (size_t)brick * dz * k_brickNodes + node.z * dz + node.y * dy + node.x;
+
+		float d000 = d[0], d100 = d[1], d010 = d[dy], d110 = d[dy + 1];
+		float d001 = d[dz], d101 = d[dz + 1], d011 = d[dz + dy], d111 = d[dz + dy + 1];
+
+		// interpolate along x, then y, then z
+		float d00 = d000 + (d100 - d000) * t.x;
+		float d10 = d010 + (d110 - d010) * t.x;
+		float d01 = d001 + (d101 - d001) * t.x;
+		float d11 = d011 + (d111 - d011) * t.x;
+		float d0 = d00 + (d10 - d00) * t.y;
+		float d1 = d01 + (d11 - d01) * t.y;
+
+		float gx0 = (d100 - d000) + ((d110 - d010) - (d100 - d000)) * t.y;
+		float gx1 = (d101 - d001) + ((d111 - d011) - (d101 - d001)) * t.y;
+		gradient.x = (gx0 + (gx1 - gx0) * t.z) / voxelSize;
+		gradient.y = ((d10 - d00) + ((d11 - d01) - (d10 - d00)) * t.z) / voxelSize;
+		gradient.z = (d1 - d0) / voxelSize;
+		return d0 + (d1 - d0) * t.z;
+	}
+};
+
+// Real-Time Collision Detection (Ericson), 5.1.5. barycentric holds the weights of a, b and c, which are exactly
+// 0 or 1 when the closest point is on an edge or a vertex.
+HOST_DEVICE inline glm::vec3 ClosestPointOnTriangle(const glm::vec3 p, const glm::vec3 a, const glm::vec3 b, const glm::vec3 c, glm::vec3& barycentric)
+{
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 ap = p - a;
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0)
+	{
+		barycentric = glm::vec3(1, 0, 0);
+		return a;
+	}
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3)
+	{
+		barycentric = glm::vec3(0, 1, 0);
+		return b;
+	}
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+	{
+		float v = d1 / (d1 - d3);
+		barycentric = glm::vec3(1 - v, v, 0);
+		return a + v * ab;
+	}
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6)
+	{
+		barycentric = glm::vec3(0, 0, 1);
+		return c;
+	}
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+	{
+		float w = d2 / (d2 - d6);
+		barycentric = glm::vec3(1 - w, 0, w);
+		return a + w * ac;
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+	{
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		barycentric = glm::vec3(0, 1 - w, w);
+		return b + w * (c - b);
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	float v = vb * denom;
+	float w = vc * denom;
+	barycentric = glm::vec3(1 - v - w, v, w);
+	return a + ab * v + ac * w;
+}
+
+// Node of a MeshBVHView. Nodes are stored depth first, so the left child of an inner node directly follows it
+// and every child comes after its parent.
+struct BVHNode
+{
+	glm::vec3 lower;
+	int start;						//!< First triangle of a leaf, right child of an inner node
+	glm::vec3 upper;
+	int count;						//!< Number of triangles of a leaf, 0 for inner nodes
+};
+
+// Deforming triangle mesh of a DynamicMeshCollider, in world space, with a bounding volume hierarchy over its
+// triangles that is refitted whenever the mesh moves (see MeshBVH.hpp). lastPositions and lastNormals are the mesh
+// at the previous physics frame, so a point of the surface can be followed from the last frame to the current one.
+struct MeshBVHView
+{
+	static constexpr int k_stackSize = 64;
+
+	const BVHNode* nodes;
+	int numNodes;
+	const int* triangles;			//!< Triangles of the leaves
+	const unsigned int* indices;
+	const glm::vec3* positions;
+	const glm::vec3* normals;		//!< Vertex normals
+	const glm::vec3* lastPositions;
+	const glm::vec3* lastNormals;
+	float maxDisplacement;			//!< Largest distance a vertex moved since the last frame
+	float thickness;				//!< Particles deeper inside are left alone, unless the surface swept over them
+
+	// Closest triangle within radius of position, or -1. Triangles that position was more than maxDepth behind
+	// at the last frame are skipped.
+	HOST_DEVICE int FindClosest(const glm::vec3 position, const float radius, const float maxDepth, glm::vec3& barycentric) const
+	{
+		if (numNodes == 0) return -1;
+
+		float minDistance2 = radius * radius;
+		int closest = -1;
+		int stack[k_stackSize];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			int index = stack[--top];
+			const BVHNode& node = nodes[index];
+			if (Distance2(node, position) >= minDistance2) continue;
+
+			if (node.count > 0)
+			{
+				for (int i = node.start; i < node.start + node.count; i++)
+				{
+					int triangle = triangles[i];
+					glm::vec3 weights;
+					glm::vec3 point = ClosestPointOnTriangle(position, positions[indices[triangle * 3]],
+						positions[indices[triangle * 3 + 1]], positions[indices[triangle * 3 + 2]], weights);
+					glm::vec3 diff = position - point;
+					float distance2 = glm::dot(diff, diff);
+					if (distance2 < minDistance2 && LastDistance(triangle, weights, position) > -maxDepth)
+					{
+						minDistance2 = distance2;
+						closest = triangle;
+						barycentric = weights;
+					}
+				}
+			}
+			else if (top + 2 <= k_stackSize)
+			{
+				// the nearer child is popped first, so it tightens the radius for the other one
+				int left = index + 1;
+				int right = node.start;
+				if (Distance2(nodes[left], position) < Distance2(nodes[right], position))
+				{
+					stack[top++] = right;
+					stack[top++] = left;
+				}
+				else
+				{
+					stack[top++] = left;
+					stack[top++] = right;
+				}
+			}
+		}
+		return closest;
+	}
+
+	// Point and normal of the surface at barycentric coordinates of a triangle, and the point at the last frame
+	HOST_DEVICE void Interpolate(const int triangle, const glm::vec3 barycentric, glm::vec3& point, glm::vec3& normal, glm::vec3& lastPoint) const
+	{
+		unsigned int a = indices[triangle * 3], b = indices[triangle * 3 + 1], c = indices[triangle * 3 + 2];
+		point = barycentric.x * positions[a] + barycentric.y * positions[b] + barycentric.z * positions[c];
+		normal = glm::normalize(barycentric.x * normals[a] + barycentric.y * normals[b] + barycentric.z * normals[c]);
+		lastPoint = barycentric.x * lastPositions[a] + barycentric.y * lastPositions[b] + barycentric.z * lastPositions[c];
+	}
+
+	// Distance of position in front of the surface point at barycentric coordinates of a triangle, at the last frame
+	HOST_DEVICE float LastDistance(const int triangle, const glm::vec3 barycentric, const glm::vec3 position) const
+	{
+		unsigned int a = indices[triangle * 3], b = indices[triangle * 3 + 1], c = indices[triangle * 3 + 2];
+		glm::vec3 lastPoint = barycentric.x * lastPositions[a] + barycentric.y * lastPositions[b] + barycentric.z * lastPositions[c];
+		glm::vec3 lastNormal = barycentric.x * lastNormals[a] + barycentric.y * lastNormals[b] + barycentric.z * lastNormals[c];
+		return glm::dot(position - lastPoint, glm::normalize(lastNormal));
+	}
+
+	HOST_DEVICE float Distance2(const BVHNode& node, const glm::vec3 position) const
+	{
+		glm::vec3 diff = position - glm::clamp(position, node.lower, node.upper);
+		return glm::dot(diff, diff);
+	}
+};
+
+// Plain collider description used by both solvers, updated from the Collider components every frame
+struct SDFCollider
+{
+	ColliderType type;
+
+	glm::vec3 position;
+	glm::vec3 scale;
+
+	float deltaTime;
+	glm::mat3 curTransform;
+	glm::mat4 invCurTransform;
+	glm::mat4 lastTransform;
+
+	SDFGridView grid;				//!< Distance field of ColliderType::Mesh, in the local space of the collider
+	MeshBVHView mesh;				//!< Surface of ColliderType::DynamicMesh, in world space
+
+	HOST_DEVICE float sgn(float value) const { return (value > 0) ? 1.0f : (value < 0 ? -1.0f : 0.0f); }
+
+	HOST_DEVICE glm::vec3 ComputeSDF(const glm::vec3 targetPosition, const float collisionMargin) const
+	{
+		if (type == ColliderType::Plane)
+		{
+			float offset = targetPosition.y - (position.y + collisionMargin);
+			if (offset < 0)
+			{
+				return glm::vec3(0, -offset, 0);
+			}
+		}
+		else if (type == ColliderType::Sphere)
+		{
+			float radius = scale.x + collisionMargin;
+			auto diff = targetPosition - position;
+			float distance = glm::length(diff);
+			float offset = distance - radius;
+			if (offset < 0)
+			{
+				glm::vec3 direction = diff / distance;
+				return -offset * direction;
+			}
+		}
+		else if (type == ColliderType::Cube)
+		{
+			glm::vec3 correction = glm::vec3(0);
+			glm::vec3 localPos = invCurTransform * glm::vec4(targetPosition, 1.0);
+			glm::vec3 cubeSize = glm::vec3(0.5f, 0.5f, 0.5f) + collisionMargin / scale;
+			glm::vec3 offset = glm::abs(localPos) - cubeSize;
+
+			float maxVal = fmaxf(offset.x, fmaxf(offset.y, offset.z));
+			float minVal = fminf(offset.x, fminf(offset.y, offset.z));
+			float midVal = offset.x  + offset.y + offset.z - maxVal - minVal;
+			float scalar = 1.0f;
+
+			if (maxVal < 0)
+			{
+				// make cube corner round to avoid particle vibration	
+				float margin = 0.03f;
+				if (midVal > -margin) scalar = 0.2f;
+				if (minVal > -margin)
+				{
+					glm::vec3 mask;
+					mask.x = offset.x < 0 ? sgn(localPos.x) : 0;
+					mask.y = offset.y < 0 ? sgn(localPos.y) : 0;
+					mask.z = offset.z < 0 ? sgn(localPos.z) : 0;
+
+					glm::vec3 vec = offset + glm::vec3(margin);
+					float len = glm::length(vec);
+					if (len < margin)
+						correction = mask * glm::normalize(vec) * (margin - len);
+				}
+				else if (offset.x == maxVal)
+				{
+					correction = glm::vec3(copysignf(-offset.x, localPos.x), 0, 0);
+				}
+				else if (offset.y == maxVal)
+				{
+					correction = glm::vec3(0, copysignf(-offset.y, localPos.y), 0);
+				}
+				else if (offset.z == maxVal)
+				{
+					correction = glm::vec3(0, 0, copysignf(-offset.z, localPos.z));
+				}
+			}
+			return curTransform * scalar * correction;
+		}
+		else if (type == ColliderType::Mesh)
+		{
+			// the grid is in local space, which is assumed to be scaled uniformly
+			glm::vec3 localPos = invCurTransform * glm::vec4(targetPosition, 1.0);
+			glm::vec3 gradient;
+			float distance = grid.Sample(localPos, gradient);
+			float offset = distance - collisionMargin / scale.x;
+			float gradientLength = glm::length(gradient);
+			if (offset < 0 && gradientLength > 0)
+			{
+				return curTransform * (-offset / gradientLength * gradient);
+			}
+		}
+		else if (type == ColliderType::DynamicMesh)
+		{
+			glm::vec3 velocity;
+			return CollideDynamicMesh(targetPosition, collisionMargin, velocity);
+		}
+		return glm::vec3(0);
+	}
+
+	// Same as above, and velocity is the velocity of the collider at the contact, which friction is relative to
+	HOST_DEVICE glm::vec3 ComputeSDF(const glm::vec3 targetPosition, const float collisionMargin, glm::vec3& velocity) const
+	{
+		velocity = glm::vec3(0);
+		if (type == ColliderType::DynamicMesh)
+		{
+			return CollideDynamicMesh(targetPosition, collisionMargin, velocity);
+		}
+
+		glm::vec3 correction = ComputeSDF(targetPosition, collisionMargin);
+		if (glm::dot(correction, correction) > 0)
+		{
+			velocity = VelocityAt(targetPosition + correction);
+		}
+		return correction;
+	}
+
+	// Velocity of a point moving with the transform of the collider
+	HOST_DEVICE glm::vec3 VelocityAt(const glm::vec3 targetPosition) const
+	{
+		glm::vec4 lastPos = lastTransform * invCurTransform * glm::vec4(targetPosition, 1.0);
+		glm::vec3 vel = (targetPosition - glm::vec3(lastPos)) / deltaTime;
+		return vel;
+	}
+
+	// Each point of the surface is followed back to the last frame. The particle collides with the closest
+	// triangle it was in front of there, so it is pushed out along the normal however far the surface moved
+	// past it, and fast limbs don't tunnel through the cloth. Particles deeper than thickness are left alone.
+	// The velocity is taken from the same point, so friction drags the cloth along the triangle it touches.
+	HOST_DEVICE glm::vec3 CollideDynamicMesh(const glm::vec3 targetPosition, const float collisionMargin, glm::vec3& velocity) const
+	{
+		float radius = collisionMargin + fmaxf(mesh.thickness, mesh.maxDisplacement);
+		glm::vec3 barycentric;
+		int triangle = mesh.FindClosest(targetPosition, radius, mesh.thickness, barycentric);
+		if (triangle >= 0)
+		{
+			glm::vec3 point, normal, lastPoint;
+			mesh.Interpolate(triangle, barycentric, point, normal, lastPoint);
+			float distance = glm::dot(targetPosition - point, normal);
+			if (distance < collisionMargin)
+			{
+				velocity = (point - lastPoint) / deltaTime;
+				return (collisionMargin - distance) * normal;
+			}
+		}
+		return glm::vec3(0);
+	}
 };
\ No newline at end of file
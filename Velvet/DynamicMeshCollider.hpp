@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Collider.hpp"
+#include "Animation.hpp"
+#include "MeshBVH.hpp"
+#include "VtNormals.hpp"
+#include "VtThreadPool.hpp"
+#include "VtBuffer.hpp"
+
+namespace VRThreads
+{
+	/// <summary>
+	/// Collider of a deforming mesh played by an Animation, e.g. a captured avatar. The mesh is kept in world space
+	/// together with its pose at the previous physics frame, and particles query the closest triangle through a
+	/// bounding volume hierarchy that is built once and refitted whenever the animation shows a new frame or the actor moves.
+	/// Add it to the actor after the Animation, so it reads each frame while the animation still holds it.
+	/// </summary>
+	class DynamicMeshCollider : public Collider
+	{
+	public:
+		// thickness is in world units, particles deeper inside the mesh are not pushed out unless the surface moved over them.
+		// The surface is updated on threadPool, which the scene shares with its other CPU work.
+		DynamicMeshCollider(shared_ptr<Animation> animation, shared_ptr<VtThreadPool> threadPool, float thickness = 0.05f)
+			: Collider(ColliderType::DynamicMesh), m_animation(animation), m_threadPool(threadPool), m_thickness(thickness)
+		{
+			name = __func__;
+		}
+
+		void Start() override
+		{
+			Collider::Start();
+
+			auto mesh = m_animation->getMesh();
+			int numVertices = (int)mesh->vertices().size();
+			m_localPositions.assign(m_animation->positions(), m_animation->positions() + numVertices);
+			m_frame = m_animation->frame();
+
+			// the tree is built in local space, refitting moves it to world space
+			m_bvh.Build(m_localPositions, mesh->indices());
+			m_normals.Initialize(m_bvh.indices(), numVertices);
+
+			m_nodes.destroy();
+			m_nodes.push_back(m_bvh.nodes());
+			m_triangles.destroy();
+			m_triangles.push_back(m_bvh.triangles());
+			m_indices.destroy();
+			m_indices.push_back(m_bvh.indices());
+			for (int i = 0; i < 2; i++)
+			{
+				m_positions[i].resize(numVertices);
+				m_vertexNormals[i].resize(numVertices);
+			}
+
+			UpdateSurface();
+			// nothing moved before the first frame
+			CopySurface(m_current, 1 - m_current);
+			m_maxDisplacement = 0;
+		}
+
+		// Called after Animation::Progress by Actor::Progress
+		void Progress(float time) override
+		{
+			if (m_animation->frame() == m_frame) return;
+
+			m_frame = m_animation->frame();
+			auto positions = m_animation->positions();
+			copy(positions, positions + m_localPositions.size(), m_localPositions.begin());
+			m_dirty = true;
+		}
+
+		void FixedUpdate() override
+		{
+			Collider::FixedUpdate();
+
+			if (m_dirty || curTransform != m_surfaceTransform)
+			{
+				UpdateSurface();
+			}
+			else
+			{
+				// the last frame of the next step is the current one
+				m_maxDisplacement = 0;
+			}
+		}
+
+		SDFCollider GetSDFCollider() const override
+		{
+			auto sc = Collider::GetSDFCollider();
+			int last = m_maxDisplacement > 0 ? 1 - m_current : m_current;
+			sc.mesh.nodes = m_nodes.data();
+			sc.mesh.numNodes = (int)m_nodes.size();
+			sc.mesh.triangles = m_triangles.data();
+			sc.mesh.indices = m_indices.data();
+			sc.mesh.positions = m_positions[m_current].data();
+			sc.mesh.normals = m_vertexNormals[m_current].data();
+			sc.mesh.lastPositions = m_positions[last].data();
+			sc.mesh.lastNormals = m_vertexNormals[last].data();
+			sc.mesh.maxDisplacement = m_maxDisplacement;
+			sc.mesh.thickness = m_thickness;
+			return sc;
+		}
+
+	private:
+		shared_ptr<Animation> m_animation;
+		shared_ptr<VtThreadPool> m_threadPool;
+		float m_thickness;
+
+		int m_frame = 0;
+		bool m_dirty = false;
+		vector<glm::vec3> m_localPositions;
+		vector<float> m_threadMaxima;
+		glm::mat4 m_surfaceTransform = glm::mat4(1);
+		float m_maxDisplacement = 0;
+
+		MeshBVH m_bvh;
+		VtNormals m_normals;
+
+		// managed memory, so that both solvers can query it. Positions and normals alternate between two slots,
+		// the other slot holds the previous frame.
+		VtBuffer<BVHNode> m_nodes;
+		VtBuffer<int> m_triangles;
+		VtBuffer<unsigned int> m_indices;
+		VtBuffer<glm::vec3> m_positions[2];
+		VtBuffer<glm::vec3> m_vertexNormals[2];
+		int m_current = 0;
+
+		void UpdateSurface()
+		{
+			ScopedTimer timer(TIMER_ID("DynamicMeshCollider_Update"));
+			int numVertices = (int)m_localPositions.size();
+			glm::mat4 transform = curTransform;
+
+			// the world space surface goes straight into the managed slot of the new frame
+			m_current = 1 - m_current;
+			auto positions = m_positions[m_current].data();
+			auto lastPositions = m_positions[1 - m_current].data();
+			m_threadMaxima.assign(m_threadPool->numThreads(), 0.0f);
+			m_threadPool->ParallelFor(numVertices, [this, &transform, positions, lastPositions](int begin, int end, int threadIndex) {
+				float maxDisplacement2 = m_threadMaxima[threadIndex];
+				for (int i = begin; i < end; i++)
+				{
+					positions[i] = glm::vec3(transform * glm::vec4(m_localPositions[i], 1.0f));
+					glm::vec3 diff = positions[i] - lastPositions[i];
+					maxDisplacement2 = max(maxDisplacement2, glm::dot(diff, diff));
+				}
+				m_threadMaxima[threadIndex] = maxDisplacement2;
+				}, k_grainSize);
+			m_maxDisplacement = sqrt(*max_element(m_threadMaxima.begin(), m_threadMaxima.end()));
+			m_normals.Compute(positions, m_vertexNormals[m_current].data(), *m_threadPool);
+
+			m_bvh.Refit(positions, m_nodes.data());
+			m_surfaceTransform = transform;
+			m_dirty = false;
+		}
+
+		void CopySurface(int from, int to)
+		{
+			copy(m_positions[from].data(), m_positions[from].data() + m_positions[from].size(), m_positions[to].data());
+			copy(m_vertexNormals[from].data(), m_vertexNormals[from].data() + m_vertexNormals[from].size(), m_vertexNormals[to].data());
+		}
+
+		const int k_grainSize = 1024;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace VRThreads
+{
+	// std140 layout of the SpotLight struct of the shaders
+	struct SpotLightUniforms
+	{
+		glm::vec3 position = glm::vec3(0);
+		float padding = 0;
+		glm::vec3 direction = glm::vec3(0);
+		float cutOff = 0;
+		float outerCutOff = 0;
+		float constant = 0;
+		float linear = 0;
+		float quadratic = 0;
+		glm::vec3 color = glm::vec3(0);
+		float ambient = 0;
+	};
+	static_assert(sizeof(SpotLightUniforms) == 64, "SpotLightUniforms mirrors a std140 struct");
+
+	/// <summary>
+	/// Camera and light data shared by every material, written to a uniform buffer once per frame by the RenderPipeline.
+	/// Shaders opt in by declaring the FrameUniforms block (e.g. Assets/Shader/_Default.vert), whose std140 layout this mirrors.
+	/// Materials without the block still get these values as plain uniforms.
+	/// </summary>
+	struct FrameUniforms
+	{
+		static const GLuint k_binding = 0;
+		static constexpr const char* k_blockName = "FrameUniforms";
+
+		glm::mat4 view = glm::mat4(1);
+		glm::mat4 projection = glm::mat4(1);
+		glm::mat4 invView = glm::mat4(1);
+		glm::mat4 worldToLight = glm::mat4(1);
+		glm::vec3 cameraPos = glm::vec3(0);
+		float padding = 0;
+		SpotLightUniforms spotLight;
+	};
+	static_assert(sizeof(FrameUniforms) == 336, "FrameUniforms mirrors a std140 uniform block");
+}
\ No newline at end of file
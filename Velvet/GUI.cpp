@@ -96,7 +96,7 @@ struct SolverTiming
 
 	void Update()
 	{
-		if (Timer::PeriodicUpdate("GUI_SOLVER", 0.2f))
+		if (Timer::PeriodicUpdate(TIMER_ID("GUI_SOLVER"), 0.2f))
 		{
 			if (Timer::frameCount() < 2)
 			{
@@ -163,6 +163,19 @@ struct SolverTiming
 
 			ImGui::EndTable();
 		}
+
+		bool tracing = Timer::tracing();
+		if (ImGui::Checkbox("Record Trace", &tracing))
+		{
+			Timer::EnableTracing(tracing);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Save Trace"))
+		{
+			Timer::WriteTrace("velvet_trace.json");
+		}
+		ImGui::SameLine();
+		HelpMarker("Writes the last recorded timer scopes to velvet_trace.json, open it in ui.perfetto.dev");
 	}
 };
 
@@ -193,19 +206,19 @@ struct PerformanceStat
 		frameCount = Timer::frameCount();
 		physicsFrameCount = Timer::physicsFrameCount();
 
-		if (Timer::PeriodicUpdate("GUI_FAST", Timer::fixedDeltaTime()))
+		if (Timer::PeriodicUpdate(TIMER_ID("GUI_FAST"), Timer::fixedDeltaTime()))
 		{
-			graphValues[graphIndex] = (float)Timer::GetTimerGPU("Solver_Total");
+			graphValues[graphIndex] = (float)Timer::GetTimerGPU(TIMER_ID("Solver_Total"));
 			graphIndex = (graphIndex + 1) % IM_ARRAYSIZE(graphValues);
 		}
 
-		if (Timer::PeriodicUpdate("GUI_SLOW", 0.3f))
+		if (Timer::PeriodicUpdate(TIMER_ID("GUI_SLOW"), 0.3f))
 		{
 			deltaTime = deltaTimeMiliseconds;
 			frameRate = elapsedTime > 0 ? (int)(frameCount / elapsedTime) : 0;
-			cpuTime = Timer::GetTimer("CPU_TIME") * 1000;
-			gpuTime = Timer::GetTimer("GPU_TIME") * 1000;
-			solverTime = Timer::GetTimerGPU("Solver_Total");
+			cpuTime = Timer::GetTimer(TIMER_ID("CPU_TIME")) * 1000;
+			gpuTime = Timer::GetTimer(TIMER_ID("GPU_TIME")) * 1000;
+			solverTime = Timer::GetTimerGPU(TIMER_ID("Solver_Total"));
 
 			for (int n = 0; n < IM_ARRAYSIZE(graphValues); n++)
 				graphAverage += graphValues[n];
@@ -389,6 +402,9 @@ void GUI::ShowOptionWindow()
 		Global::input->ToggleOnKeyDown(GLFW_KEY_K, Global::gameState.drawParticles);
 		ImGui::Checkbox("Draw Wireframe (L)", &Global::gameState.renderWireframe);
 		Global::input->ToggleOnKeyDown(GLFW_KEY_L, Global::gameState.renderWireframe);
+		ImGui::Checkbox("Bake Cache", &Global::gameState.bakeCache);
+		ImGui::SameLine();
+		HelpMarker("Writes the simulated frames to velvet_bake*.vtc until unchecked");
 		ImGui::Dummy(ImVec2(0.0f, 10.0f));
 	}
 
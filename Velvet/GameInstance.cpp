@@ -146,7 +146,7 @@ void GameInstance::MainLoop()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glPolygonMode(GL_FRONT_AND_BACK, Global::gameState.renderWireframe ? GL_LINE : GL_FILL);
 
-		Timer::StartTimer("CPU_TIME");
+		Timer::StartTimer(TIMER_ID("CPU_TIME"));
 		Timer::UpdateDeltaTime();
 
 		// Logic Updates
@@ -175,7 +175,10 @@ void GameInstance::MainLoop()
 
 		godUpdate.Invoke();
 
-		Timer::EndTimer("CPU_TIME");
+		Timer::EndTimer(TIMER_ID("CPU_TIME"));
+
+		// textures decoded in the background replace their placeholders
+		Resource::UploadTextures();
 
 		// Render
 		m_renderPipeline->Render();
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace VRThreads
+{
+	using namespace std;
+
+	/// <summary>
+	/// Read-only memory mapping of a whole file. Pages are loaded by the OS on first access,
+	/// so opening a large file is cheap and random access only touches the pages it reads.
+	/// </summary>
+	class MappedFile
+	{
+	public:
+		MappedFile() {}
+
+		MappedFile(const MappedFile&) = delete;
+
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile()
+		{
+			Close();
+		}
+
+		bool Open(const string& path)
+		{
+			Close();
+#ifdef _WIN32
+			m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				fmt::print("Error(MappedFile): Failed to open [{}].\n", path);
+				return false;
+			}
+			LARGE_INTEGER size;
+			GetFileSizeEx(m_file, &size);
+			m_size = (size_t)size.QuadPart;
+			if (m_size > 0)
+			{
+				m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				m_data = m_mapping ? (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			}
+#else
+			m_file = open(path.c_str(), O_RDONLY);
+			if (m_file < 0)
+			{
+				fmt::print("Error(MappedFile): Failed to open [{}].\n", path);
+				return false;
+			}
+			struct stat info;
+			fstat(m_file, &info);
+			m_size = (size_t)info.st_size;
+			if (m_size > 0)
+			{
+				void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+				m_data = data == MAP_FAILED ? nullptr : (const uint8_t*)data;
+			}
+#endif
+			if (m_size > 0 && m_data == nullptr)
+			{
+				fmt::print("Error(MappedFile): Failed to map [{}].\n", path);
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+#ifdef _WIN32
+			if (m_data) UnmapViewOfFile(m_data);
+			if (m_mapping) CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+			m_mapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+#else
+			if (m_data) munmap((void*)m_data, m_size);
+			if (m_file >= 0) close(m_file);
+			m_file = -1;
+#endif
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		const uint8_t* data() const
+		{
+			return m_data;
+		}
+
+		size_t size() const
+		{
+			return m_size;
+		}
+
+		bool isOpen() const
+		{
+			return m_data != nullptr;
+		}
+
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+	};
+}
\ No newline at end of file
@@ -10,6 +10,9 @@
 #include <GLFW/glfw3.h>
 #include <fmt/core.h>
 
+#include "ShaderCache.hpp"
+#include "FrameUniforms.hpp"
+
 using namespace std;
 
 namespace VRThreads
@@ -23,10 +26,24 @@ namespace VRThreads
 
 		Material(string& vertexCode, string& fragmentCode, string& geometryCode)
 		{
-			const char* vShaderCode = vertexCode.c_str();
-			const char* fShaderCode = fragmentCode.c_str();
-			const char* gShaderCode = geometryCode.c_str();
-			m_shaderID = CompileShader(vShaderCode, fShaderCode, gShaderCode);
+			// reuse the program binary of an earlier run when the sources and the driver are unchanged
+			auto key = ShaderCache::Key(vertexCode, fragmentCode, geometryCode);
+			m_shaderID = ShaderCache::Load(key);
+			if (m_shaderID == 0)
+			{
+				const char* vShaderCode = vertexCode.c_str();
+				const char* fShaderCode = fragmentCode.c_str();
+				const char* gShaderCode = geometryCode.c_str();
+				m_shaderID = CompileShader(vShaderCode, fShaderCode, gShaderCode);
+				ShaderCache::Store(key, m_shaderID);
+			}
+
+			auto blockIndex = glGetUniformBlockIndex(m_shaderID, FrameUniforms::k_blockName);
+			m_usesFrameUniforms = blockIndex != GL_INVALID_INDEX;
+			if (m_usesFrameUniforms)
+			{
+				glUniformBlockBinding(m_shaderID, blockIndex, FrameUniforms::k_binding);
+			}
 		}
 
 		Material(const Material&) = delete;
@@ -62,6 +79,7 @@ namespace VRThreads
 				glAttachShader(shader, geometry);
 			}
 			// shader Program
+			ShaderCache::SetRetrievable(shader);
 			glLinkProgram(shader);
 			CheckCompileErrors(shader, "PROGRAM");
 			// delete the shaders as they're linked into our program now and no longer necessary
@@ -76,14 +94,81 @@ namespace VRThreads
 			return m_shaderID;
 		}
 
+		// Whether the shaders read camera and light data from the FrameUniforms block
+		bool usesFrameUniforms() const
+		{
+			return m_usesFrameUniforms;
+		}
+
+		// Puts a cached material back into the state of a freshly loaded one: default settings, no textures
+		// and every uniform zeroed, as after linking. Used when the material is reused by another scene.
+		void ResetState()
+		{
+			textures.clear();
+			specular = 0.2f;
+			smoothness = 100.0f;
+			doubleSided = false;
+			noWireframe = false;
+
+			GLint count = 0;
+			glGetProgramiv(m_shaderID, GL_ACTIVE_UNIFORMS, &count);
+			Use();
+			vector<float> zeros;
+			vector<int> intZeros;
+			for (GLint i = 0; i < count; i++)
+			{
+				char uniformName[256];
+				GLint size = 0;
+				GLenum type = 0;
+				glGetActiveUniform(m_shaderID, i, sizeof(uniformName), nullptr, &size, &type, uniformName);
+				// members of uniform blocks have no location
+				GLint location = glGetUniformLocation(m_shaderID, uniformName);
+				if (location < 0) continue;
+
+				zeros.assign(size * 16, 0.0f);
+				intZeros.assign(size * 4, 0);
+				switch (type)
+				{
+				case GL_FLOAT: glUniform1fv(location, size, zeros.data()); break;
+				case GL_FLOAT_VEC2: glUniform2fv(location, size, zeros.data()); break;
+				case GL_FLOAT_VEC3: glUniform3fv(location, size, zeros.data()); break;
+				case GL_FLOAT_VEC4: glUniform4fv(location, size, zeros.data()); break;
+				case GL_FLOAT_MAT2: glUniformMatrix2fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT3: glUniformMatrix3fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT4: glUniformMatrix4fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT2x3: glUniformMatrix2x3fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT2x4: glUniformMatrix2x4fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT3x2: glUniformMatrix3x2fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT3x4: glUniformMatrix3x4fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT4x2: glUniformMatrix4x2fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_FLOAT_MAT4x3: glUniformMatrix4x3fv(location, size, GL_FALSE, zeros.data()); break;
+				case GL_INT_VEC2: case GL_BOOL_VEC2: glUniform2iv(location, size, intZeros.data()); break;
+				case GL_INT_VEC3: case GL_BOOL_VEC3: glUniform3iv(location, size, intZeros.data()); break;
+				case GL_INT_VEC4: case GL_BOOL_VEC4: glUniform4iv(location, size, intZeros.data()); break;
+				case GL_UNSIGNED_INT: glUniform1uiv(location, size, (const GLuint*)intZeros.data()); break;
+				case GL_UNSIGNED_INT_VEC2: glUniform2uiv(location, size, (const GLuint*)intZeros.data()); break;
+				case GL_UNSIGNED_INT_VEC3: glUniform3uiv(location, size, (const GLuint*)intZeros.data()); break;
+				case GL_UNSIGNED_INT_VEC4: glUniform4uiv(location, size, (const GLuint*)intZeros.data()); break;
+				// int, bool and samplers
+				default: glUniform1iv(location, size, intZeros.data()); break;
+				}
+			}
+		}
+
 		void Use() const
 		{
 			glUseProgram(m_shaderID);
 		}
 
+		// Each name is looked up once, programs are never relinked
 		GLint GetLocation(const string& name) const
 		{
-			return glGetUniformLocation(m_shaderID, name.c_str());
+			auto it = m_locations.find(name);
+			if (it != m_locations.end()) return it->second;
+
+			GLint location = glGetUniformLocation(m_shaderID, name.c_str());
+			m_locations[name] = location;
+			return location;
 		}
 
 		// utility uniform functions
@@ -173,6 +258,24 @@ namespace VRThreads
 			Use();
 			glUniformMatrix4fv(GetLocation(name), 1, GL_FALSE, &mat[0][0]);
 		}
+		// ------------------------------------------------------------------------
+		// setters for locations from GetLocation(), for uniforms written every draw. The material must be in use.
+		void SetInt(GLint location, int value) const
+		{
+			glUniform1i(location, value);
+		}
+		void SetFloat(GLint location, float value) const
+		{
+			glUniform1f(location, value);
+		}
+		void SetMat3(GLint location, const glm::mat3& mat) const
+		{
+			glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+		}
+		void SetMat4(GLint location, const glm::mat4& mat) const
+		{
+			glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+		}
 
 		string name = "";
 		float specular = 0.2f;
@@ -181,6 +284,8 @@ namespace VRThreads
 		bool noWireframe = false;
 	private:
 		unsigned int m_shaderID = -1;
+		bool m_usesFrameUniforms = false;
+		mutable unordered_map<string, GLint> m_locations;
 
 		void CheckCompileErrors(unsigned int shader, std::string type) const
 		{
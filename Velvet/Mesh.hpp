@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <algorithm> 
+#include <cstring>
+#include <cstdint>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -27,6 +29,8 @@ namespace VRThreads
 			}
 			unsigned int numVertices = (unsigned int)packedVertices.size() / stride;
 
+			m_positions.reserve(numVertices);
+			m_texCoords.reserve(numVertices);
 			for (unsigned int i = 0; i < numVertices; i++)
 			{
 				unsigned int baseV = stride * i;
@@ -40,19 +44,33 @@ namespace VRThreads
 				}
 				m_texCoords.push_back(glm::vec2(packedVertices[baseT + 0], packedVertices[baseT + 1]));
 			}
-			Initialize(m_positions, m_normals, m_texCoords, indices, attributeSizes);
+			m_indices = move(indices);
+			Initialize();
 		}
 
-		Mesh(const vector<glm::vec3>& vertices, const vector<glm::vec3>& normals = vector<glm::vec3>(),
-			const vector<glm::vec2>& texCoords = vector<glm::vec2>(), const vector<unsigned int>& indices = vector<unsigned int>())
+		// The mesh keeps the arrays, pass them with std::move when the caller doesn't need them anymore
+		Mesh(vector<glm::vec3> vertices, vector<glm::vec3> normals = vector<glm::vec3>(),
+			vector<glm::vec2> texCoords = vector<glm::vec2>(), vector<unsigned int> indices = vector<unsigned int>())
 		{
-			Initialize(vertices, normals, texCoords, indices);
+			m_positions = move(vertices);
+			m_normals = move(normals);
+			m_texCoords = move(texCoords);
+			m_indices = move(indices);
+			Initialize();
 		}
 
 		Mesh(const Mesh&) = delete;
 
 		~Mesh()
 		{
+			for (auto& fence : m_streamFences)
+			{
+				if (fence) glDeleteSync(fence);
+			}
+			if (m_streamBuffer > 0)
+			{
+				glDeleteBuffers(1, &m_streamBuffer);
+			}
 			if (m_EBO > 0)
 			{
 				glDeleteBuffers(1, &m_EBO);
@@ -108,6 +126,8 @@ namespace VRThreads
 			return m_indices;
 		}
 
+		// Buffers written on the GPU (e.g. CUDA interop). Meshes updated with SetVerticesAndNormals may stream
+		// from a separate buffer instead, see StreamVerticesAndNormals.
 		const GLuint verticesVBO() const
 		{
 			return m_VBOs[0];
@@ -120,13 +140,33 @@ namespace VRThreads
 
 		void SetVerticesAndNormals(const vector<glm::vec3>& vertices, const vector<glm::vec3>& normals)
 		{
-			auto size = vertices.size() * sizeof(glm::vec3);
-			m_positions = vertices;
-			m_normals = normals;
+			SetVerticesAndNormals(vertices.data(), normals.data(), vertices.size());
+		}
+
+		// Both arrays hold count elements. Per-frame updates (simulation, cache playback) only go to the GPU:
+		// vertices() and normals() keep the data the mesh had when its vertex count last changed.
+		// Updates stream through a persistently mapped buffer when the driver supports it, otherwise the
+		// buffers are updated in place while the vertex count is unchanged.
+		void SetVerticesAndNormals(const glm::vec3* vertices, const glm::vec3* normals, size_t count)
+		{
+			bool resized = count != m_positions.size();
+			if (resized)
+			{
+				m_positions.assign(vertices, vertices + count);
+				m_normals.assign(normals, normals + count);
+			}
+			if (StreamVerticesAndNormals(vertices, normals, count)) return;
+
+			bool reallocate = !m_dynamic || resized;
+			auto size = count * sizeof(glm::vec3);
 			glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[0]);
-			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_DYNAMIC_DRAW);
+			if (reallocate) glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
+			else glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
 			glBindBuffer(GL_ARRAY_BUFFER, m_VBOs[1]);
-			glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_DYNAMIC_DRAW);
+			if (reallocate) glBufferData(GL_ARRAY_BUFFER, size, normals, GL_DYNAMIC_DRAW);
+			else glBufferSubData(GL_ARRAY_BUFFER, 0, size, normals);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			m_dynamic = true;
 		}
 
 		GLuint AllocateVBO(unsigned int floatCount, bool instanceAttribute = false)
@@ -160,14 +200,115 @@ namespace VRThreads
 		GLuint m_VAO = 0;
 		GLuint m_EBO = 0;
 		vector<GLuint> m_VBOs;
+		bool m_dynamic = false; // position and normal buffers were reallocated with GL_DYNAMIC_DRAW
+
+		// Streaming: positions and normals of k_streamFrames updates in one persistently mapped buffer.
+		// Each update writes the next region once the GPU is done with it, so writes never wait on draws in flight.
+		static const int k_streamFrames = 3;
+		GLuint m_streamBuffer = 0;
+		uint8_t* m_streamMapping = nullptr;
+		size_t m_streamCount = 0;
+		int m_streamRegion = -1;
+		GLsync m_streamFences[k_streamFrames] = {};
+		bool m_streamFailed = false;
+
+		// Persistent mapping needs OpenGL 4.4 or ARB_buffer_storage, the context itself is 3.3
+		static bool streamingSupported()
+		{
+			static int s_supported = -1;
+			if (s_supported < 0)
+			{
+				s_supported = 0;
+#ifdef GL_VERSION_4_4
+				if (GLAD_GL_VERSION_4_4) s_supported = 1;
+#endif
+#ifdef GL_ARB_buffer_storage
+				if (GLAD_GL_ARB_buffer_storage) s_supported = 1;
+#endif
+			}
+			return s_supported == 1;
+		}
+
+		bool StreamVerticesAndNormals(const glm::vec3* vertices, const glm::vec3* normals, size_t count)
+		{
+			// attribute 1 holds normals only when the mesh was created with them
+			if (!streamingSupported() || m_streamFailed || m_normals.empty() || count == 0) return false;
+			if (count != m_streamCount && !CreateStreamBuffer(count)) return false;
+
+			// fence the commands issued since the last update, including the draws that read the current region
+			if (m_streamRegion >= 0)
+			{
+				m_streamFences[m_streamRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			}
+			m_streamRegion = (m_streamRegion + 1) % k_streamFrames;
+			auto& fence = m_streamFences[m_streamRegion];
+			if (fence)
+			{
+				GLenum result;
+				do
+				{
+					result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+				} while (result == GL_TIMEOUT_EXPIRED);
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+
+			size_t size = count * sizeof(glm::vec3);
+			size_t offset = m_streamRegion * 2 * size;
+			memcpy(m_streamMapping + offset, vertices, size);
+			memcpy(m_streamMapping + offset + size, normals, size);
+
+			glBindVertexArray(m_VAO);
+			glBindBuffer(GL_ARRAY_BUFFER, m_streamBuffer);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)offset);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)(offset + size));
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glBindVertexArray(0);
+			return true;
+		}
+
+		bool CreateStreamBuffer(size_t count)
+		{
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+			for (auto& fence : m_streamFences)
+			{
+				if (fence) glDeleteSync(fence);
+				fence = nullptr;
+			}
+			if (m_streamBuffer > 0)
+			{
+				glDeleteBuffers(1, &m_streamBuffer);
+			}
+
+			// storage is immutable, so a new vertex count needs a new buffer
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			GLsizeiptr size = k_streamFrames * 2 * count * sizeof(glm::vec3);
+			glGenBuffers(1, &m_streamBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, m_streamBuffer);
+			glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+			m_streamMapping = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			if (m_streamMapping)
+			{
+				m_streamCount = count;
+				m_streamRegion = -1;
+				return true;
+			}
+			glDeleteBuffers(1, &m_streamBuffer);
+			m_streamBuffer = 0;
+#endif
+			m_streamCount = 0;
+			m_streamFailed = true;
+			return false;
+		}
 
-		void Initialize(const vector<glm::vec3>& vertices, const vector<glm::vec3>& normals, const vector<glm::vec2>& texCoords,
-			const vector<unsigned int>& indices, vector<unsigned int> attributeSizes = {})
+		// Creates the buffers from m_positions, m_normals, m_texCoords and m_indices
+		void Initialize()
 		{
-			m_positions = vertices;
-			m_normals = normals;
-			m_texCoords = texCoords;
-			m_indices = indices;
+			const auto& vertices = m_positions;
+			const auto& normals = m_normals;
+			const auto& texCoords = m_texCoords;
+			const auto& indices = m_indices;
 
 			// 1. bind Vertex Array Object
 			glGenVertexArrays(1, &m_VAO);
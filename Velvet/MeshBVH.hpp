@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+#include "Common.hpp"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	/// <summary>
+	/// Bounding volume hierarchy of a deforming triangle mesh (MeshBVHView). The tree is built once from the first
+	/// pose by median splits, and only refitted when the vertices move: the topology stays the same and the boxes are
+	/// recomputed bottom up in O(n), which is much cheaper than a rebuild and good enough for skinned or captured
+	/// bodies whose triangles keep their neighbours.
+	/// </summary>
+	class MeshBVH
+	{
+	public:
+		static constexpr int k_leafSize = 4;
+
+		void Build(const vector<glm::vec3>& positions, const vector<unsigned int>& indices)
+		{
+			m_indices.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+			int numTriangles = (int)(m_indices.size() / 3);
+
+			vector<glm::vec3> centers(numTriangles);
+			for (int i = 0; i < numTriangles; i++)
+			{
+				centers[i] = (positions[m_indices[i * 3]] + positions[m_indices[i * 3 + 1]] + positions[m_indices[i * 3 + 2]]) / 3.0f;
+			}
+
+			m_triangles.resize(numTriangles);
+			iota(m_triangles.begin(), m_triangles.end(), 0);
+			m_nodes.clear();
+			m_nodes.reserve(max(1, numTriangles / k_leafSize * 2));
+			if (numTriangles > 0) BuildNode(0, numTriangles, centers);
+
+			Refit(positions.data(), m_nodes.data());
+		}
+
+		// Writes the boxes of the current positions into nodes, which has the layout of nodes()
+		void Refit(const glm::vec3* positions, BVHNode* nodes) const
+		{
+			for (int i = (int)m_nodes.size() - 1; i >= 0; i--)
+			{
+				auto& node = nodes[i];
+				if (m_nodes[i].count > 0)
+				{
+					glm::vec3 lower = glm::vec3(FLT_MAX);
+					glm::vec3 upper = glm::vec3(-FLT_MAX);
+					for (int k = m_nodes[i].start; k < m_nodes[i].start + m_nodes[i].count; k++)
+					{
+						int triangle = m_triangles[k];
+						for (int j = 0; j < 3; j++)
+						{
+							const auto& position = positions[m_indices[triangle * 3 + j]];
+							lower = glm::min(lower, position);
+							upper = glm::max(upper, position);
+						}
+					}
+					node.lower = lower;
+					node.upper = upper;
+				}
+				else
+				{
+					// children come after their parent, so they are already refitted
+					const auto& left = nodes[i + 1];
+					const auto& right = nodes[m_nodes[i].start];
+					node.lower = glm::min(left.lower, right.lower);
+					node.upper = glm::max(left.upper, right.upper);
+				}
+				node.start = m_nodes[i].start;
+				node.count = m_nodes[i].count;
+			}
+		}
+
+		// Boxes of the last Build or Refit into these nodes
+		const vector<BVHNode>& nodes() const
+		{
+			return m_nodes;
+		}
+
+		const vector<int>& triangles() const
+		{
+			return m_triangles;
+		}
+
+		const vector<unsigned int>& indices() const
+		{
+			return m_indices;
+		}
+
+	private:
+		vector<BVHNode> m_nodes;
+		vector<int> m_triangles;
+		vector<unsigned int> m_indices;
+
+		int BuildNode(int begin, int end, const vector<glm::vec3>& centers)
+		{
+			int index = (int)m_nodes.size();
+			m_nodes.push_back(BVHNode());
+			if (end - begin <= k_leafSize)
+			{
+				m_nodes[index].start = begin;
+				m_nodes[index].count = end - begin;
+				return index;
+			}
+
+			// split at the median of the longest axis of the triangle centers, which keeps the tree balanced
+			glm::vec3 lower = glm::vec3(FLT_MAX);
+			glm::vec3 upper = glm::vec3(-FLT_MAX);
+			for (int i = begin; i < end; i++)
+			{
+				lower = glm::min(lower, centers[m_triangles[i]]);
+				upper = glm::max(upper, centers[m_triangles[i]]);
+			}
+			glm::vec3 extent = upper - lower;
+			int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+			int middle = (begin + end) / 2;
+			nth_element(m_triangles.begin() + begin, m_triangles.begin() + middle, m_triangles.begin() + end,
+				[&centers, axis](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+
+			BuildNode(begin, middle, centers);
+			int right = BuildNode(middle, end, centers);
+			m_nodes[index].start = right;
+			m_nodes[index].count = 0;
+			return index;
+		}
+	};
+}
\ No newline at end of file
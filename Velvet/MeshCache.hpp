@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <filesystem>
+
+#include <fmt/format.h>
+
+#include "MappedFile.hpp"
+#include "MeshSequence.hpp"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	// Post-processed meshes on disk, so repeated loads skip the importer.
+	// A cache file (Cache/Mesh/<key>.vtmesh) is a MeshCacheHeader followed by
+	//   float3 positions[numVertices], float3 normals[numVertices], float2 texCoords[numVertices], uint32 indices[numIndices]
+	// The key hashes the source path and the import flags, the header also keeps the size and write time of the source,
+	// so editing a model invalidates its cache.
+	struct MeshCacheHeader
+	{
+		static const uint32_t k_version = 1;
+
+		char magic[4] = { 'V', 'T', 'M', 'C' };
+		uint32_t version = k_version;
+		uint64_t sourceTime = 0;
+		uint64_t sourceSize = 0;
+		uint32_t importFlags = 0;
+		uint32_t numVertices = 0;
+		uint32_t numIndices = 0;
+		uint32_t reserved = 0;
+	};
+	static_assert(sizeof(MeshCacheHeader) == 40, "MeshCacheHeader is part of the file format");
+
+	class MeshCache
+	{
+	public:
+		static inline bool enabled = true;
+		static inline string directory = "Cache/Mesh/";
+
+		// Fills data from the cache of sourcePath, returns false when there is no valid cache
+		static bool Load(const string& sourcePath, uint32_t importFlags, MeshFrameData& data)
+		{
+			if (!enabled) return false;
+
+			MeshCacheHeader expected;
+			if (!SourceInfo(sourcePath, importFlags, expected)) return false;
+
+			MappedFile file;
+			auto path = CachePath(sourcePath, importFlags);
+			if (!filesystem::exists(path) || !file.Open(path)) return false;
+			if (file.size() < sizeof(MeshCacheHeader)) return false;
+
+			MeshCacheHeader header;
+			memcpy(&header, file.data(), sizeof(header));
+			if (memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version ||
+				header.sourceTime != expected.sourceTime || header.sourceSize != expected.sourceSize || header.importFlags != importFlags)
+			{
+				return false;
+			}
+
+			size_t n = header.numVertices;
+			size_t size = sizeof(header) + n * (2 * sizeof(glm::vec3) + sizeof(glm::vec2)) + header.numIndices * sizeof(unsigned int);
+			if (file.size() != size) return false;
+
+			const uint8_t* in = file.data() + sizeof(header);
+			Read(in, data.positions, n);
+			Read(in, data.normals, n);
+			Read(in, data.texCoords, n);
+			Read(in, data.indices, header.numIndices);
+			return true;
+		}
+
+		// Written to a temporary file first, so concurrent loaders never see a partial cache
+		static void Store(const string& sourcePath, uint32_t importFlags, const MeshFrameData& data)
+		{
+			if (!enabled) return;
+
+			MeshCacheHeader header;
+			if (!SourceInfo(sourcePath, importFlags, header)) return;
+			header.numVertices = (uint32_t)data.positions.size();
+			header.numIndices = (uint32_t)data.indices.size();
+			if (data.normals.size() != header.numVertices || data.texCoords.size() != header.numVertices) return;
+
+			error_code error;
+			filesystem::create_directories(directory, error);
+			auto path = CachePath(sourcePath, importFlags);
+			auto tempPath = fmt::format("{}.{}.tmp", path, hash<thread::id>()(this_thread::get_id()));
+			{
+				ofstream out(tempPath, ios::binary | ios::trunc);
+				if (!out) return;
+				out.write((const char*)&header, sizeof(header));
+				Write(out, data.positions);
+				Write(out, data.normals);
+				Write(out, data.texCoords);
+				Write(out, data.indices);
+				if (!out.good())
+				{
+					out.close();
+					filesystem::remove(tempPath, error);
+					return;
+				}
+			}
+			filesystem::rename(tempPath, path, error);
+			if (error)
+			{
+				filesystem::remove(tempPath, error);
+			}
+		}
+
+	private:
+		static string CachePath(const string& sourcePath, uint32_t importFlags)
+		{
+			// FNV-1a of the path and the flags
+			uint64_t key = 14695981039346656037ull;
+			for (char c : sourcePath)
+			{
+				key = (key ^ (uint8_t)c) * 1099511628211ull;
+			}
+			key = (key ^ importFlags) * 1099511628211ull;
+			return fmt::format("{}{:016x}.vtmesh", directory, key);
+		}
+
+		static bool SourceInfo(const string& sourcePath, uint32_t importFlags, MeshCacheHeader& header)
+		{
+			error_code error;
+			auto size = filesystem::file_size(sourcePath, error);
+			if (error) return false;
+			auto time = filesystem::last_write_time(sourcePath, error);
+			if (error) return false;
+
+			header.sourceSize = (uint64_t)size;
+			header.sourceTime = (uint64_t)time.time_since_epoch().count();
+			header.importFlags = importFlags;
+			return true;
+		}
+
+		template <class T>
+		static void Read(const uint8_t*& in, vector<T>& out, size_t count)
+		{
+			out.resize(count);
+			memcpy(out.data(), in, count * sizeof(T));
+			in += count * sizeof(T);
+		}
+
+		template <class T>
+		static void Write(ofstream& out, const vector<T>& data)
+		{
+			out.write((const char*)data.data(), data.size() * sizeof(T));
+		}
+	};
+}
\ No newline at end of file
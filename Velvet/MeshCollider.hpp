@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Collider.hpp"
+#include "Mesh.hpp"
+#include "MeshSDF.hpp"
+#include "VtBuffer.hpp"
+
+namespace VRThreads
+{
+	/// <summary>
+	/// Collider of a static triangle mesh, e.g. an .obj asset. The signed distance field of the mesh is baked once
+	/// when the collider starts (see MeshSDF), after that a particle costs one grid sample whatever the number of triangles.
+	/// The actor can move and rotate, and scale uniformly, but the mesh itself must not deform.
+	/// </summary>
+	class MeshCollider : public Collider
+	{
+	public:
+		// voxelSize and bandWidth are in world units, at the scale of the actor when the collider starts.
+		// bandWidth should be larger than the collision margin plus the distance a particle moves in a substep.
+		MeshCollider(shared_ptr<Mesh> mesh, float voxelSize = 0.02f, float bandWidth = 0.15f)
+			: Collider(ColliderType::Mesh), m_mesh(mesh), m_voxelSize(voxelSize), m_bandWidth(bandWidth)
+		{
+			name = __func__;
+		}
+
+		void Start() override
+		{
+			Collider::Start();
+
+			Timer::StartTimer("BAKE_MESH_SDF");
+			// the grid is baked in the local space of the mesh
+			float scale = actor->transform->scale.x;
+			m_sdf.Build(m_mesh->vertices(), m_mesh->indices(), m_voxelSize / scale, m_bandWidth / scale);
+
+			// managed memory, so that both solvers can sample it
+			m_bricks.destroy();
+			m_bricks.push_back(m_sdf.bricks());
+			m_distances.destroy();
+			m_distances.push_back(m_sdf.distances());
+
+			double time = Timer::EndTimer("BAKE_MESH_SDF") * 1000;
+			fmt::print("Info(MeshCollider): Baked {} bricks ({:.2f} MB) for {} triangles in {:.2f} ms\n", m_sdf.numBricks(),
+				m_sdf.memory() / (1024.0 * 1024.0), m_mesh->indices().size() / 3, time);
+		}
+
+		SDFCollider GetSDFCollider() const override
+		{
+			auto sc = Collider::GetSDFCollider();
+			sc.grid = m_sdf.view();
+			sc.grid.bricks = m_bricks.data();
+			sc.grid.distances = m_distances.data();
+			return sc;
+		}
+
+	private:
+		shared_ptr<Mesh> m_mesh;
+		float m_voxelSize;
+		float m_bandWidth;
+
+		MeshSDF m_sdf;
+		VtBuffer<int> m_bricks;
+		VtBuffer<float> m_distances;
+	};
+}
\ No newline at end of file
@@ -17,6 +17,16 @@ namespace VRThreads
 		if (castShadow)
 		{
 			m_shadowMaterial = Resource::LoadMaterial("_ShadowDepth");
+			m_locations.shadowModel = m_shadowMaterial->GetLocation("_Model");
+			m_locations.shadowWorldToLight = m_shadowMaterial->GetLocation("_WorldToLight");
+		}
+		if (m_material)
+		{
+			m_locations.model = m_material->GetLocation("_Model");
+			m_locations.mvp = m_material->GetLocation("_MVP");
+			m_locations.normalMatrix = m_material->GetLocation("_Normalmatrix");
+			m_locations.specular = m_material->GetLocation("material.specular");
+			m_locations.smoothness = m_material->GetLocation("material.smoothness");
 		}
 	}
 
@@ -30,7 +40,7 @@ namespace VRThreads
 		m_mesh = mesh;
 	}
 
-	// Only support spot light for now
+	// Only support spot light for now. Materials with the FrameUniforms block get the light from RenderPipeline instead.
 	void MeshRenderer::SetupLighting(shared_ptr<Material> m_material)
 	{
 		if (Global::lights.size() == 0)
@@ -39,7 +49,7 @@ namespace VRThreads
 		}
 		auto light = Global::lights[0];
 
-		auto prefix = fmt::format("spotLight.");
+		const string prefix = "spotLight.";
 		auto front = Helper::RotateWithDegree(glm::vec3(0, -1, 0), light->transform()->rotation);
 
 		m_material->SetVec3(prefix + "position", light->position());
@@ -65,8 +75,8 @@ namespace VRThreads
 		m_material->Use();
 
 		// material
-		m_material->SetFloat("material.specular", m_material->specular);
-		m_material->SetFloat("material.smoothness", m_material->smoothness);
+		m_material->SetFloat(m_locations.specular, m_material->specular);
+		m_material->SetFloat(m_locations.smoothness, m_material->smoothness);
 		m_material->SetTexture("_ShadowTex", Global::game->depthFrameBuffer());
 
 		if (m_materialProperty.preRendering)
@@ -74,15 +84,17 @@ namespace VRThreads
 			m_materialProperty.preRendering(m_material.get());
 		}
 
-		// camera param
-		m_material->SetVec3("_CameraPos", Global::camera->transform()->position);
-
-		// light params
-		SetupLighting(m_material);
+		// camera and light params
+		bool frameUniforms = m_material->usesFrameUniforms();
+		if (!frameUniforms)
+		{
+			m_material->SetVec3("_CameraPos", Global::camera->transform()->position);
+			SetupLighting(m_material);
+		}
 
 		// texture
 		int i = 0;
-		for (auto tex : m_material->textures)
+		for (const auto& tex : m_material->textures)
 		{
 			glActiveTexture(GL_TEXTURE0 + i);
 			glBindTexture(GL_TEXTURE_2D, tex.second);
@@ -95,15 +107,19 @@ namespace VRThreads
 		auto view = Global::camera->view();
 		auto projection = Global::camera->projection();
 
-		m_material->SetMat4("_Model", model);
-		m_material->SetMat4("_View", view);
-		m_material->SetMat4("_Projection", projection);
-
-		m_material->SetMat4("_MVP", projection * view * model);
-		m_material->SetMat4("_InvView", glm::inverse(view));
-		m_material->SetMat3("_Normalmatrix", glm::mat3(glm::transpose(glm::inverse(model))));
+		// preRendering may have switched programs
+		m_material->Use();
+		m_material->SetMat4(m_locations.model, model);
+		m_material->SetMat4(m_locations.mvp, projection * view * model);
+		m_material->SetMat3(m_locations.normalMatrix, glm::mat3(glm::transpose(glm::inverse(model))));
 
-		m_material->SetMat4("_WorldToLight", lightMatrix);
+		if (!frameUniforms)
+		{
+			m_material->SetMat4("_View", view);
+			m_material->SetMat4("_Projection", projection);
+			m_material->SetMat4("_InvView", glm::inverse(view));
+			m_material->SetMat4("_WorldToLight", lightMatrix);
+		}
 
 		DrawCall();
 	}	
@@ -116,8 +132,8 @@ namespace VRThreads
 		}
 
 		m_shadowMaterial->Use();
-		m_shadowMaterial->SetMat4("_Model", actor->transform->matrix());
-		m_shadowMaterial->SetMat4("_WorldToLight", lightMatrix);
+		m_shadowMaterial->SetMat4(m_locations.shadowModel, actor->transform->matrix());
+		m_shadowMaterial->SetMat4(m_locations.shadowWorldToLight, lightMatrix);
 
 		DrawCall();
 	}
@@ -42,6 +42,18 @@ namespace VRThreads
 
 		void SetupLighting(shared_ptr<Material> m_material);
 
+		// locations of the uniforms written every draw, looked up once
+		struct UniformLocations
+		{
+			GLint model = -1;
+			GLint mvp = -1;
+			GLint normalMatrix = -1;
+			GLint specular = -1;
+			GLint smoothness = -1;
+			GLint shadowModel = -1;
+			GLint shadowWorldToLight = -1;
+		} m_locations;
+
 		int m_numInstances = 0;
 		shared_ptr<Mesh> m_mesh;
 		shared_ptr<Material> m_material;
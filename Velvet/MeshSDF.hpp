@@ -0,0 +1,322 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+#include "Common.hpp"
+#include "VtThreadPool.hpp"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	/// <summary>
+	/// Bakes the signed distance field of a triangle mesh into a sparse narrow band grid (SDFGridView).
+	/// Only bricks within bandWidth of a triangle are stored. Each of their nodes holds the exact distance to the
+	/// closest triangle, and the sign comes from the angle weighted pseudonormal of the closest feature
+	/// (Baerentzen and Aanaes), which is robust at edges and vertices of closed meshes.
+	/// Nodes farther than bandWidth are clamped to +-bandWidth, with the sign of the closest triangle of their brick, so the
+	/// interpolation has no false zero crossing at the edge of the band. Particles deeper than bandWidth inside are not pushed out.
+	/// </summary>
+	class MeshSDF
+	{
+	public:
+		// voxelSize and bandWidth are in the units of positions
+		void Build(const vector<glm::vec3>& positions, const vector<unsigned int>& indices, float voxelSize, float bandWidth)
+		{
+			WeldVertices(positions, indices);
+			ComputePseudonormals();
+
+			m_voxelSize = voxelSize;
+			m_bandWidth = bandWidth;
+
+			glm::vec3 lower = glm::vec3(FLT_MAX);
+			glm::vec3 upper = glm::vec3(-FLT_MAX);
+			for (const auto& position : m_positions)
+			{
+				lower = glm::min(lower, position);
+				upper = glm::max(upper, position);
+			}
+			if (m_positions.empty()) lower = upper = glm::vec3(0);
+
+			float brickSize = voxelSize * SDFGridView::k_brickCells;
+			m_origin = lower - glm::vec3(bandWidth + voxelSize);
+			m_numBricks = glm::max(glm::ivec3(glm::ceil((upper + glm::vec3(bandWidth + voxelSize) - m_origin) / brickSize)), glm::ivec3(1));
+
+			// triangles that can be within the band of each brick, by their bounding boxes
+			size_t numBrickCells = (size_t)m_numBricks.x * m_numBricks.y * m_numBricks.z;
+			vector<vector<int>> brickTriangles(numBrickCells);
+			for (int i = 0; i < (int)m_faceNormals.size(); i++)
+			{
+				if (m_faceNormals[i] == glm::vec3(0)) continue;
+
+				glm::vec3 a = m_positions[m_indices[i * 3]];
+				glm::vec3 b = m_positions[m_indices[i * 3 + 1]];
+				glm::vec3 c = m_positions[m_indices[i * 3 + 2]];
+				glm::ivec3 first = BrickOf(glm::min(a, glm::min(b, c)) - glm::vec3(bandWidth));
+				glm::ivec3 last = BrickOf(glm::max(a, glm::max(b, c)) + glm::vec3(bandWidth));
+				for (int z = first.z; z <= last.z; z++)
+					for (int y = first.y; y <= last.y; y++)
+						for (int x = first.x; x <= last.x; x++)
+						{
+							brickTriangles[BrickIndex(x, y, z)].push_back(i);
+						}
+			}
+
+			vector<int> candidates;
+			for (int i = 0; i < (int)numBrickCells; i++)
+			{
+				if (!brickTriangles[i].empty()) candidates.push_back(i);
+			}
+
+			const int nodesPerBrick = SDFGridView::k_brickNodes * SDFGridView::k_brickNodes * SDFGridView::k_brickNodes;
+			vector<float> distances((size_t)candidates.size() * nodesPerBrick);
+			vector<char> inBand(candidates.size(), 0);
+			VtThreadPool threadPool;
+			threadPool.ParallelFor((int)candidates.size(), [&](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					inBand[i] = BakeBrick(candidates[i], brickTriangles[candidates[i]], &distances[(size_t)i * nodesPerBrick]);
+				}
+				}, 1);
+
+			// bricks whose nodes are all out of the band are dropped
+			m_bricks.assign(numBrickCells, -1);
+			m_distances.clear();
+			int numBricks = 0;
+			for (int i = 0; i < (int)candidates.size(); i++)
+			{
+				if (!inBand[i]) continue;
+				m_bricks[candidates[i]] = numBricks++;
+				m_distances.insert(m_distances.end(), distances.begin() + (size_t)i * nodesPerBrick, distances.begin() + (size_t)(i + 1) * nodesPerBrick);
+			}
+		}
+
+		// Points into the memory of this object
+		SDFGridView view() const
+		{
+			SDFGridView grid;
+			grid.origin = m_origin;
+			grid.voxelSize = m_voxelSize;
+			grid.numBricks = m_numBricks;
+			grid.bandWidth = m_bandWidth;
+			grid.bricks = m_bricks.data();
+			grid.distances = m_distances.data();
+			return grid;
+		}
+
+		const vector<int>& bricks() const
+		{
+			return m_bricks;
+		}
+
+		const vector<float>& distances() const
+		{
+			return m_distances;
+		}
+
+		// Number of stored bricks
+		int numBricks() const
+		{
+			const int nodesPerBrick = SDFGridView::k_brickNodes * SDFGridView::k_brickNodes * SDFGridView::k_brickNodes;
+			return (int)(m_distances.size() / nodesPerBrick);
+		}
+
+		size_t memory() const
+		{
+			return m_bricks.size() * sizeof(int) + m_distances.size() * sizeof(float);
+		}
+
+	private:
+		enum Feature { Face, VertexA, VertexB, VertexC, EdgeAB, EdgeBC, EdgeCA };
+
+		glm::vec3 m_origin = glm::vec3(0);
+		float m_voxelSize = 1;
+		glm::ivec3 m_numBricks = glm::ivec3(0);
+		float m_bandWidth = 0;
+		vector<int> m_bricks;
+		vector<float> m_distances;
+
+		// welded mesh and its pseudonormals, only used while baking
+		vector<glm::vec3> m_positions;
+		vector<unsigned int> m_indices;
+		vector<glm::vec3> m_faceNormals;
+		vector<glm::vec3> m_vertexNormals;
+		vector<glm::vec3> m_edgeNormals; // 3 per triangle: ab, bc, ca
+		vector<glm::vec4> m_triangleBounds; // bounding sphere of each triangle, skips most closest point queries
+
+		glm::ivec3 BrickOf(glm::vec3 position) const
+		{
+			glm::ivec3 brick = glm::ivec3(glm::floor((position - m_origin) / (m_voxelSize * SDFGridView::k_brickCells)));
+			return glm::clamp(brick, glm::ivec3(0), m_numBricks - 1);
+		}
+
+		int BrickIndex(int x, int y, int z) const
+		{
+			return (z * m_numBricks.y + y) * m_numBricks.x + x;
+		}
+
+		// Imported meshes split vertices along uv and normal seams, which would break the pseudonormals
+		void WeldVertices(const vector<glm::vec3>& positions, const vector<unsigned int>& indices)
+		{
+			struct KeyHash
+			{
+				size_t operator()(const glm::vec3& v) const
+				{
+					uint32_t bits[3];
+					memcpy(bits, &v, sizeof(bits));
+					return ((size_t)bits[0] * 73856093) ^ ((size_t)bits[1] * 19349663) ^ ((size_t)bits[2] * 83492791);
+				}
+			};
+			unordered_map<glm::vec3, unsigned int, KeyHash> welded;
+			vector<unsigned int> remap(positions.size());
+			m_positions.clear();
+			for (size_t i = 0; i < positions.size(); i++)
+			{
+				auto result = welded.insert({ positions[i], (unsigned int)m_positions.size() });
+				if (result.second) m_positions.push_back(positions[i]);
+				remap[i] = result.first->second;
+			}
+
+			m_indices.resize(indices.size() / 3 * 3);
+			for (size_t i = 0; i < m_indices.size(); i++)
+			{
+				m_indices[i] = remap[indices[i]];
+			}
+		}
+
+		void ComputePseudonormals()
+		{
+			int numTriangles = (int)(m_indices.size() / 3);
+			m_faceNormals.assign(numTriangles, glm::vec3(0));
+			m_vertexNormals.assign(m_positions.size(), glm::vec3(0));
+			m_edgeNormals.assign(numTriangles * 3, glm::vec3(0));
+			m_triangleBounds.assign(numTriangles, glm::vec4(0));
+
+			unordered_map<uint64_t, glm::vec3> edges;
+			auto EdgeKey = [](unsigned int i, unsigned int j) {
+				return ((uint64_t)min(i, j) << 32) | max(i, j);
+			};
+
+			for (int i = 0; i < numTriangles; i++)
+			{
+				unsigned int idx[3] = { m_indices[i * 3], m_indices[i * 3 + 1], m_indices[i * 3 + 2] };
+				glm::vec3 normal = glm::cross(m_positions[idx[1]] - m_positions[idx[0]], m_positions[idx[2]] - m_positions[idx[0]]);
+				float area2 = glm::length(normal);
+				if (area2 < 1e-12f) continue;
+				normal /= area2;
+				m_faceNormals[i] = normal;
+
+				glm::vec3 center = (m_positions[idx[0]] + m_positions[idx[1]] + m_positions[idx[2]]) / 3.0f;
+				float radius = max(glm::distance(center, m_positions[idx[0]]), max(glm::distance(center, m_positions[idx[1]]), glm::distance(center, m_positions[idx[2]])));
+				m_triangleBounds[i] = glm::vec4(center, radius);
+
+				for (int k = 0; k < 3; k++)
+				{
+					glm::vec3 p = m_positions[idx[k]];
+					glm::vec3 e1 = m_positions[idx[(k + 1) % 3]] - p;
+					glm::vec3 e2 = m_positions[idx[(k + 2) % 3]] - p;
+					float angle = acos(glm::clamp(glm::dot(glm::normalize(e1), glm::normalize(e2)), -1.0f, 1.0f));
+					m_vertexNormals[idx[k]] += angle * normal;
+					edges[EdgeKey(idx[k], idx[(k + 1) % 3])] += normal;
+				}
+			}
+
+			for (int i = 0; i < numTriangles; i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					m_edgeNormals[i * 3 + k] = edges[EdgeKey(m_indices[i * 3 + k], m_indices[i * 3 + (k + 1) % 3])];
+				}
+			}
+		}
+
+		// Returns whether any node is within the band
+		bool BakeBrick(int brickIndex, const vector<int>& triangles, float* distances) const
+		{
+			glm::ivec3 brick;
+			brick.x = brickIndex % m_numBricks.x;
+			brick.y = (brickIndex / m_numBricks.x) % m_numBricks.y;
+			brick.z = brickIndex / (m_numBricks.x * m_numBricks.y);
+			glm::vec3 brickOrigin = m_origin + glm::vec3(brick * SDFGridView::k_brickCells) * m_voxelSize;
+
+			bool inBand = false;
+			float band2 = m_bandWidth * m_bandWidth;
+			for (int z = 0; z < SDFGridView::k_brickNodes; z++)
+				for (int y = 0; y < SDFGridView::k_brickNodes; y++)
+					for (int x = 0; x < SDFGridView::k_brickNodes; x++)
+					{
+						glm::vec3 p = brickOrigin + glm::vec3(x, y, z) * m_voxelSize;
+
+						// the closest candidate is also searched beyond the band, its pseudonormal gives the sign of far nodes
+						float minDistance2 = FLT_MAX;
+						glm::vec3 closest = p;
+						glm::vec3 pseudonormal = glm::vec3(0);
+						for (int triangle : triangles)
+						{
+							const auto& bounds = m_triangleBounds[triangle];
+							float lowerBound = glm::distance(p, glm::vec3(bounds)) - bounds.w;
+							if (lowerBound > 0 && lowerBound * lowerBound >= minDistance2) continue;
+
+							Feature feature;
+							glm::vec3 point = ClosestPointOnTriangle(p, triangle, feature);
+							glm::vec3 diff = p - point;
+							float distance2 = glm::dot(diff, diff);
+							if (distance2 < minDistance2)
+							{
+								minDistance2 = distance2;
+								closest = point;
+								pseudonormal = Pseudonormal(triangle, feature);
+							}
+						}
+
+						float distance = m_bandWidth;
+						if (minDistance2 < band2)
+						{
+							distance = sqrt(minDistance2);
+							inBand = true;
+						}
+						if (glm::dot(p - closest, pseudonormal) < 0) distance = -distance;
+						*distances++ = distance;
+					}
+			return inBand;
+		}
+
+		glm::vec3 Pseudonormal(int triangle, Feature feature) const
+		{
+			switch (feature)
+			{
+			case VertexA: return m_vertexNormals[m_indices[triangle * 3]];
+			case VertexB: return m_vertexNormals[m_indices[triangle * 3 + 1]];
+			case VertexC: return m_vertexNormals[m_indices[triangle * 3 + 2]];
+			case EdgeAB: return m_edgeNormals[triangle * 3];
+			case EdgeBC: return m_edgeNormals[triangle * 3 + 1];
+			case EdgeCA: return m_edgeNormals[triangle * 3 + 2];
+			default: return m_faceNormals[triangle];
+			}
+		}
+
+		glm::vec3 ClosestPointOnTriangle(glm::vec3 p, int triangle, Feature& feature) const
+		{
+			glm::vec3 barycentric;
+			glm::vec3 point = ::ClosestPointOnTriangle(p, m_positions[m_indices[triangle * 3]],
+				m_positions[m_indices[triangle * 3 + 1]], m_positions[m_indices[triangle * 3 + 2]], barycentric);
+
+			if (barycentric.x == 1) feature = VertexA;
+			else if (barycentric.y == 1) feature = VertexB;
+			else if (barycentric.z == 1) feature = VertexC;
+			else if (barycentric.z == 0) feature = EdgeAB;
+			else if (barycentric.x == 0) feature = EdgeBC;
+			else if (barycentric.y == 0) feature = EdgeCA;
+			else feature = Face;
+			return point;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <fmt/format.h>
+
+#include "VtNormals.hpp"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	// CPU side geometry of one frame of a mesh sequence
+	struct MeshFrameData
+	{
+		vector<glm::vec3> positions;
+		vector<glm::vec3> normals;
+		vector<glm::vec2> texCoords;
+		vector<unsigned int> indices;
+	};
+
+	/// <summary>
+	/// Frames of an animated mesh. Every frame shares the topology of frame 0, only positions and normals change.
+	/// </summary>
+	class MeshSequence
+	{
+	public:
+		virtual ~MeshSequence() {}
+
+		virtual int numFrames() const = 0;
+
+		// Topology, texture coordinates and the geometry of frame 0
+		virtual const MeshFrameData& firstFrame() const = 0;
+
+		// Hint that playback is at the given frame and moves forward
+		virtual void Prefetch(int frame) {}
+
+		// Returns false when the frame isn't available yet. Pointers stay valid until the next Prefetch/GetFrame call.
+		virtual bool GetFrame(int frame, const glm::vec3*& positions, const glm::vec3*& normals) = 0;
+	};
+
+	/// <summary>
+	/// Streams a numbered sequence of mesh files. Frames are decoded on background threads into a bounded ring of
+	/// slots that covers the frames ahead of the playback position, so startup time and memory don't grow with the
+	/// length of the sequence. Frames that aren't decoded in time are reported as unavailable instead of stalling.
+	/// </summary>
+	class MeshSequenceStream : public MeshSequence
+	{
+	public:
+		// Decodes the file at path, returns false on failure. Called from the decode threads.
+		using Loader = function<bool(const string&, MeshFrameData&)>;
+
+		// pathFormat is formatted with the frame number, e.g. "body{:06d}.obj"
+		MeshSequenceStream(const string& pathFormat, int startFrame, int endFrame, Loader loader, int capacity = 32, int numThreads = 2)
+		{
+			m_pathFormat = pathFormat;
+			m_startFrame = startFrame;
+			m_numFrames = max(0, endFrame - startFrame + 1);
+			m_loader = loader;
+
+			if (m_numFrames > 0 && !m_loader(FramePath(0), m_first))
+			{
+				fmt::print("Error(MeshSequence): Failed to load first frame ({})\n", FramePath(0));
+				m_numFrames = 0;
+			}
+
+			m_slots.resize(max(1, min(capacity, m_numFrames)));
+			numThreads = max(1, numThreads);
+			for (int i = 0; i < numThreads; i++)
+			{
+				m_workers.emplace_back([this]() { WorkerLoop(); });
+			}
+		}
+
+		MeshSequenceStream(const MeshSequenceStream&) = delete;
+
+		~MeshSequenceStream()
+		{
+			{
+				lock_guard<mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_wakeUp.notify_all();
+			for (auto& worker : m_workers)
+			{
+				worker.join();
+			}
+		}
+
+		int numFrames() const override
+		{
+			return m_numFrames;
+		}
+
+		const MeshFrameData& firstFrame() const override
+		{
+			return m_first;
+		}
+
+		// Keeps the next capacity frames (wrapping around) requested, evicting slots that fell behind the window
+		void Prefetch(int frame) override
+		{
+			if (m_numFrames == 0) return;
+
+			int window = (int)m_slots.size();
+			auto InWindow = [this, frame, window](int f) {
+				return f >= 0 && (f - frame + m_numFrames) % m_numFrames < window;
+			};
+
+			bool queued = false;
+			{
+				lock_guard<mutex> lock(m_mutex);
+				for (int i = 0; i < window; i++)
+				{
+					int f = (frame + i) % m_numFrames;
+					if (FindSlot(f) >= 0) continue;
+
+					int slotIndex = -1;
+					for (int s = 0; s < m_slots.size(); s++)
+					{
+						if (!InWindow(m_slots[s].frame))
+						{
+							slotIndex = s;
+							break;
+						}
+					}
+					if (slotIndex < 0) break;
+
+					auto& slot = m_slots[slotIndex];
+					slot.frame = f;
+					slot.ready = false;
+					slot.generation++;
+					m_jobs.push_back({ slotIndex, f, slot.generation });
+					queued = true;
+				}
+			}
+			if (queued) m_wakeUp.notify_all();
+		}
+
+		bool GetFrame(int frame, const glm::vec3*& positions, const glm::vec3*& normals) override
+		{
+			lock_guard<mutex> lock(m_mutex);
+			int slotIndex = FindSlot(frame);
+			if (slotIndex < 0 || !m_slots[slotIndex].ready) return false;
+
+			const auto& data = m_slots[slotIndex].data;
+			positions = data.positions.data();
+			normals = data.normals.data();
+			return true;
+		}
+
+	private:
+		struct Slot
+		{
+			int frame = -1;
+			bool ready = false;
+			int generation = 0; // bumped on reuse, so a late decode of an evicted frame is dropped
+			MeshFrameData data;
+		};
+
+		struct Job
+		{
+			int slot;
+			int frame;
+			int generation;
+		};
+
+		string m_pathFormat;
+		int m_startFrame = 0;
+		int m_numFrames = 0;
+		Loader m_loader;
+		MeshFrameData m_first;
+
+		vector<Slot> m_slots;
+		deque<Job> m_jobs;
+		vector<thread> m_workers;
+		mutex m_mutex;
+		condition_variable m_wakeUp;
+		bool m_stop = false;
+
+		string FramePath(int frame) const
+		{
+			return fmt::format(m_pathFormat, m_startFrame + frame);
+		}
+
+		int FindSlot(int frame) const
+		{
+			for (int s = 0; s < m_slots.size(); s++)
+			{
+				if (m_slots[s].frame == frame) return s;
+			}
+			return -1;
+		}
+
+		void WorkerLoop()
+		{
+			MeshFrameData data;
+			while (true)
+			{
+				Job job;
+				{
+					unique_lock<mutex> lock(m_mutex);
+					m_wakeUp.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+					if (m_stop) return;
+					job = m_jobs.front();
+					m_jobs.pop_front();
+					// the slot was evicted before its frame was decoded
+					if (m_slots[job.slot].generation != job.generation) continue;
+				}
+
+				// decoding happens outside of the lock
+				bool loaded = m_loader(FramePath(job.frame), data);
+				if (loaded && data.positions.size() != m_first.positions.size())
+				{
+					fmt::print("Error(MeshSequence): Frame ({}) has {} vertices, the first frame has {}\n", FramePath(job.frame),
+						data.positions.size(), m_first.positions.size());
+					loaded = false;
+				}
+				if (!loaded)
+				{
+					// fall back to the first frame rather than retrying on every prefetch
+					data = m_first;
+				}
+
+				lock_guard<mutex> lock(m_mutex);
+				auto& slot = m_slots[job.slot];
+				if (slot.generation == job.generation)
+				{
+					swap(slot.data.positions, data.positions);
+					swap(slot.data.normals, data.normals);
+					slot.ready = true;
+				}
+			}
+		}
+	};
+
+	/// <summary>
+	/// Whole sequence in memory with the topology stored once. Positions of all frames live in one contiguous block,
+	/// optionally quantized to 16 bits per component against per-frame bounds. Normals aren't stored,
+	/// they are recomputed when a frame is requested.
+	/// </summary>
+	class AnimatedMesh : public MeshSequence
+	{
+	public:
+		AnimatedMesh(const MeshFrameData& first, int numFrames, bool quantize = false)
+		{
+			m_first = first;
+			m_numFrames = numFrames;
+			m_numVertices = (int)first.positions.size();
+			m_quantize = quantize;
+			m_vertexNormals.Initialize(first.indices, m_numVertices);
+			m_normals.resize(m_numVertices);
+
+			size_t count = (size_t)numFrames * m_numVertices * 3;
+			if (quantize)
+			{
+				m_quantized.resize(count);
+				m_frameMin.resize(numFrames);
+				m_frameExtent.resize(numFrames);
+			}
+			else
+			{
+				m_positions.resize(count);
+			}
+			if (numFrames > 0) SetFrame(0, first.positions);
+		}
+
+		// Frames can be set from several threads at once as long as each thread writes different frames
+		bool SetFrame(int frame, const vector<glm::vec3>& positions)
+		{
+			if (positions.size() != m_numVertices) return false;
+
+			size_t base = (size_t)frame * m_numVertices * 3;
+			if (!m_quantize)
+			{
+				memcpy(&m_positions[base], positions.data(), m_numVertices * sizeof(glm::vec3));
+				return true;
+			}
+
+			glm::vec3 lower = positions[0], upper = positions[0];
+			for (const auto& p : positions)
+			{
+				lower = glm::min(lower, p);
+				upper = glm::max(upper, p);
+			}
+			glm::vec3 extent = upper - lower;
+			for (int i = 0; i < m_numVertices; i++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					float t = extent[c] > 0 ? (positions[i][c] - lower[c]) / extent[c] : 0.0f;
+					m_quantized[base + i * 3 + c] = (uint16_t)(glm::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+				}
+			}
+			m_frameMin[frame] = lower;
+			m_frameExtent[frame] = extent;
+			return true;
+		}
+
+		int numFrames() const override
+		{
+			return m_numFrames;
+		}
+
+		const MeshFrameData& firstFrame() const override
+		{
+			return m_first;
+		}
+
+		bool GetFrame(int frame, const glm::vec3*& positions, const glm::vec3*& normals) override
+		{
+			if (frame < 0 || frame >= m_numFrames) return false;
+
+			if (frame != m_decodedFrame)
+			{
+				size_t base = (size_t)frame * m_numVertices * 3;
+				const glm::vec3* framePositions = nullptr;
+				if (!m_quantize)
+				{
+					framePositions = (const glm::vec3*)(m_positions.data() + base);
+				}
+				else
+				{
+					m_decoded.resize(m_numVertices);
+					glm::vec3 scale = m_frameExtent[frame] / 65535.0f;
+					for (int i = 0; i < m_numVertices; i++)
+					{
+						const uint16_t* q = &m_quantized[base + i * 3];
+						m_decoded[i] = m_frameMin[frame] + glm::vec3(q[0], q[1], q[2]) * scale;
+					}
+					framePositions = m_decoded.data();
+				}
+				m_vertexNormals.Compute(framePositions, m_normals.data());
+				m_framePositions = framePositions;
+				m_decodedFrame = frame;
+			}
+			positions = m_framePositions;
+			normals = m_normals.data();
+			return true;
+		}
+
+		// Bytes used by the positions of all frames
+		size_t frameMemory() const
+		{
+			return m_quantize ? m_quantized.size() * sizeof(uint16_t) + m_numFrames * 2 * sizeof(glm::vec3) : m_positions.size() * sizeof(float);
+		}
+
+	private:
+		MeshFrameData m_first;
+		int m_numFrames = 0;
+		int m_numVertices = 0;
+		bool m_quantize = false;
+
+		vector<float> m_positions; // numFrames * numVertices * 3
+		vector<uint16_t> m_quantized;
+		vector<glm::vec3> m_frameMin;
+		vector<glm::vec3> m_frameExtent;
+
+		int m_decodedFrame = -1;
+		const glm::vec3* m_framePositions = nullptr;
+		vector<glm::vec3> m_decoded;
+		vector<glm::vec3> m_normals;
+		VtNormals m_vertexNormals;
+	};
+}
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "GameInstance.hpp"
+#include "Camera.hpp"
+#include "Helper.hpp"
 #include "Light.hpp"
 #include "MeshRenderer.hpp"
+#include "FrameUniforms.hpp"
 
 namespace VRThreads
 {
@@ -32,6 +35,11 @@ namespace VRThreads
 			glDrawBuffer(GL_NONE);
 			glReadBuffer(GL_NONE);
 			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+			glGenBuffers(1, &frameUniformBuffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
 		}
 
 		RenderPipeline(const RenderPipeline&) = delete;
@@ -46,20 +54,59 @@ namespace VRThreads
 			{
 				glDeleteTextures(1, &depthTex);
 			}
+			if (frameUniformBuffer > 0)
+			{
+				glDeleteBuffers(1, &frameUniformBuffer);
+			}
 		}
 
 		void Render()
 		{
 			vector<MeshRenderer*> renderers = Global::game->FindComponents<MeshRenderer>();
 			//renderers = Cull(renderers);
-			RenderShadow(renderers);
-			RenderObjects(renderers);
+			auto lightSpaceMatrix = ComputeLightMatrix();
+			UpdateFrameUniforms(lightSpaceMatrix);
+			RenderShadow(renderers, lightSpaceMatrix);
+			RenderObjects(renderers, lightSpaceMatrix);
 		}
 
 		unsigned int depthFrameBuffer = 0;
 		unsigned int depthTex = 0;
+		unsigned int frameUniformBuffer = 0;
 	private:
 
+		// Camera and light data is written once per frame instead of once per renderer
+		void UpdateFrameUniforms(const glm::mat4& lightSpaceMatrix)
+		{
+			FrameUniforms data;
+			data.view = Global::camera->view();
+			data.projection = Global::camera->projection();
+			data.invView = glm::inverse(data.view);
+			data.worldToLight = lightSpaceMatrix;
+			data.cameraPos = Global::camera->transform()->position;
+
+			// only spot lights are supported for now
+			if (Global::lights.size() > 0)
+			{
+				auto light = Global::lights[0];
+				auto& spotLight = data.spotLight;
+				spotLight.position = light->position();
+				spotLight.direction = Helper::RotateWithDegree(glm::vec3(0, -1, 0), light->transform()->rotation);
+				spotLight.cutOff = glm::cos(glm::radians(light->innerCutoff));
+				spotLight.outerCutOff = glm::cos(glm::radians(light->outerCutoff));
+				spotLight.constant = light->constant;
+				spotLight.linear = light->linear;
+				spotLight.quadratic = light->quadratic;
+				spotLight.color = light->color;
+				spotLight.ambient = light->ambient;
+			}
+
+			glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &data);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			glBindBufferBase(GL_UNIFORM_BUFFER, FrameUniforms::k_binding, frameUniformBuffer);
+		}
+
 		glm::mat4 ComputeLightMatrix()
 		{
 			if (Global::lights.size() == 0)
@@ -88,7 +135,7 @@ namespace VRThreads
 			return lightSpaceMatrix;
 		}
 
-		void RenderShadow(vector<MeshRenderer*> renderers)
+		void RenderShadow(const vector<MeshRenderer*>& renderers, const glm::mat4& lightSpaceMatrix)
 		{
 			if (Global::lights.size() == 0)
 				return;
@@ -100,8 +147,6 @@ namespace VRThreads
 
 			glCullFace(GL_FRONT);
 
-			auto lightSpaceMatrix = ComputeLightMatrix();
-
 			for (auto r : renderers)
 			{
 				if (r->enabled)
@@ -114,14 +159,12 @@ namespace VRThreads
 			glViewport(0, 0, originalWindowSize.x, originalWindowSize.y);
 		}
 
-		void RenderObjects(vector<MeshRenderer*> renderers)
+		void RenderObjects(const vector<MeshRenderer*>& renderers, const glm::mat4& lightSpaceMatrix)
 		{        
 			// reset viewport
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			glCullFace(GL_BACK);
 
-			auto lightSpaceMatrix = ComputeLightMatrix();
-
 			for (auto r : renderers)
 			{
 				if (r->enabled)
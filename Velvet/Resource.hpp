@@ -14,14 +14,23 @@
 #include "External/stb_image.h"
 #include "Mesh.hpp"
 #include "Animation.hpp"
+#include "MeshSequence.hpp"
+#include "MeshCache.hpp"
+#include "VtThreadPool.hpp"
 #include "Material.hpp"
+#include "ResourceCache.hpp"
+#include "TextureLoader.hpp"
 
 namespace VRThreads
 {
 	class Resource
 	{
 	public:
+		// Memory kept for meshes that no scene references anymore, see ReleaseUnused
+		static inline size_t meshBudget = 256 * 1024 * 1024;
 
+		// Returns right away with a placeholder texture, the image is decoded in the background
+		// and replaces the placeholder once UploadTextures() ran on the render thread.
 		static unsigned int LoadTexture(const string& path)
 		{
 			if (textureCache.count(path) > 0)
@@ -29,110 +38,133 @@ namespace VRThreads
 				return textureCache[path];
 			}
 
-            unsigned int textureID;
-            glGenTextures(1, &textureID);
+			unsigned int textureID = TextureLoader::CreatePlaceholder();
 			textureCache[path] = textureID;
+			textureLoader.Load(textureID, { path, defaultTexturePath + path });
+			return textureID;
+		}
 
-            int width, height, nrComponents;
-            unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-			if (data == nullptr)
+		// Uploads decoded textures, spread over frames so large images don't stall a single frame
+		static void UploadTextures(size_t budget = 32 * 1024 * 1024)
+		{
+			textureLoader.Upload(budget);
+		}
+
+		// Frames are streamed from disk while playing, see MeshSequenceStream. timeInterval is the time between two frames.
+		static shared_ptr<Animation> LoadAnimation(const string& pathFormat, int startFrame, int endFrame, float timeInterval, int prefetchFrames = 32)
+		{
+			auto sequence = make_shared<MeshSequenceStream>(pathFormat, startFrame, endFrame, LoadMeshData, prefetchFrames);
+			return make_shared<Animation>(sequence, timeInterval);
+		}
+
+		// Loads every frame up front into an AnimatedMesh: topology once, positions in one block (16 bit when quantized).
+		// For sequences that are replayed often and fit in memory, LoadAnimation streams instead.
+		static shared_ptr<Animation> LoadAnimatedMesh(const string& pathFormat, int startFrame, int endFrame, float timeInterval, bool quantize = false)
+		{
+			int numFrames = max(0, endFrame - startFrame + 1);
+			MeshFrameData first;
+			if (numFrames == 0 || !LoadMeshData(fmt::format(pathFormat, startFrame), first))
 			{
-				data = stbi_load((defaultTexturePath+path).c_str(), &width, &height, &nrComponents, 0);
+				fmt::print("Error(Resource): Fail to load animation ({})\n", pathFormat);
+				numFrames = 0;
 			}
-            if (data)
-            {
-				GLenum internalFormat = GL_RED;
-				GLenum dataFormat = GL_RED;
+			auto sequence = make_shared<AnimatedMesh>(first, numFrames, quantize);
 
-				if (nrComponents == 3)
-				{
-					internalFormat = GL_SRGB;
-					dataFormat = GL_RGB;
-				}
-				else if (nrComponents == 4)
+			VtThreadPool threadPool;
+			threadPool.ParallelFor(numFrames - 1, [&](int begin, int end, int threadIndex) {
+				MeshFrameData data;
+				for (int i = begin; i < end; i++)
 				{
-					internalFormat = GL_SRGB_ALPHA;
-					dataFormat = GL_RGBA;
+					int frame = i + 1;
+					auto path = fmt::format(pathFormat, startFrame + frame);
+					// a broken frame repeats the first one
+					if (!LoadMeshData(path, data) || !sequence->SetFrame(frame, data.positions))
+					{
+						fmt::print("Error(Resource): Frame ({}) replaced by the first frame\n", path);
+						sequence->SetFrame(frame, first.positions);
+					}
 				}
-
-				glBindTexture(GL_TEXTURE_2D, textureID);
-				glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
-
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-                stbi_image_free(data);
-            }
-            else
-            {
-				fmt::print("Error(Resource): Texture failed to load at path({})\n", path);
-                stbi_image_free(data);
-            }
-
-            return textureID;
+			}, 1);
+			return make_shared<Animation>(sequence, timeInterval);
 		}
 
-		static shared_ptr<Animation> LoadAnimation(const string& pathFormat, int startFrame, int endFrame, float timeInterval)
+		static shared_ptr<Mesh> LoadMesh(const string& path)
 		{
-			vector<shared_ptr<Mesh>> vMeshes;
-			string path;
-			shared_ptr<Mesh> currMesh;
-
-			for (int i = startFrame; i <= endFrame; i++) {
-				path = fmt::format(pathFormat, i);
-				currMesh = LoadMesh(path);
-				vMeshes.push_back(currMesh);
+			if (auto mesh = meshCache.Get(path))
+			{
+				return mesh;
 			}
-			return shared_ptr<Animation>(new Animation(vMeshes, timeInterval));
+
+			MeshFrameData data;
+			if (!LoadMeshData(path, data))
+			{
+				return shared_ptr<Mesh>();
+			}
+			// accounted twice, for the copy kept by Mesh and for the OpenGL buffers
+			size_t bytes = data.positions.size() * sizeof(glm::vec3) + data.normals.size() * sizeof(glm::vec3) +
+				data.texCoords.size() * sizeof(glm::vec2) + data.indices.size() * sizeof(unsigned int);
+			// the imported arrays are handed over to the mesh
+			auto result = shared_ptr<Mesh>(new Mesh(move(data.positions), move(data.normals), move(data.texCoords), move(data.indices)));
+			meshCache.Put(path, result, 2 * bytes);
+			return result;
 		}
 
-		static shared_ptr<Mesh> LoadMesh(const string& path)
+		// Imports the first mesh of a model file without touching OpenGL, so it can run on any thread
+		static bool LoadMeshData(const string& path, MeshFrameData& data)
 		{
-			if (meshCache.count(path) > 0)
+			auto& vertices = data.positions;
+			auto& normals = data.normals;
+			auto& texCoords = data.texCoords;
+			auto& indices = data.indices;
+			vertices.clear();
+			normals.clear();
+			texCoords.clear();
+			indices.clear();
+
+			// models under the default path are imported with flat normals, other paths with smooth normals
+			const unsigned int defaultFlags = aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+			const unsigned int pathFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+			if (MeshCache::Load(defaultMeshPath + path, defaultFlags, data) || MeshCache::Load(path, pathFlags, data))
 			{
-				return meshCache[path];
+				return true;
 			}
 
-			vector<glm::vec3> vertices;
-			vector<glm::vec3> normals;
-			vector<glm::vec2> texCoords;
-			vector<unsigned int> indices;
-
+			string sourcePath = defaultMeshPath + path;
+			unsigned int flags = defaultFlags;
 			Assimp::Importer importer;
-			const aiScene* scene = importer.ReadFile(defaultMeshPath + path, aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+			const aiScene* scene = importer.ReadFile(sourcePath, flags);
 			// check for errors
 			if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 			{
-				scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+				sourcePath = path;
+				flags = pathFlags;
+				scene = importer.ReadFile(sourcePath, flags);
 
 				if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 				{	
 					fmt::print("Error(Resource) Fail to load mesh ({})\n", path);
-					return shared_ptr<Mesh>();
+					return false;
 				}
 			}
 			aiMesh* mesh = scene->mMeshes[0];
 
-			int drawCount = mesh->mNumVertices;
+			if (!mesh->HasNormals())
+			{
+				fmt::print("Error(Resource) Normals not found ({})\n", path);
+				return false;
+			}
 
+			vertices.reserve(mesh->mNumVertices);
+			normals.reserve(mesh->mNumVertices);
+			texCoords.reserve(mesh->mNumVertices);
+			indices.reserve((size_t)mesh->mNumFaces * 3);
 			// walk through each of the mesh's vertices
 			for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 			{
 				// positions
 				vertices.push_back(AdaptVector(mesh->mVertices[i]));
 				// normals
-				if (mesh->HasNormals())
-				{
-					normals.push_back(AdaptVector(mesh->mNormals[i]));
-				}
-				else
-				{
-					fmt::print("Normals not found\n");
-					exit(-1);
-				}
+				normals.push_back(AdaptVector(mesh->mNormals[i]));
 				// texture coordinates
 				if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
 				{
@@ -151,16 +183,15 @@ namespace VRThreads
 				for (unsigned int j = 0; j < face.mNumIndices; j++)
 					indices.push_back(face.mIndices[j]);
 			}
-			auto result = shared_ptr<Mesh>(new Mesh(vertices, normals, texCoords, indices));
-			meshCache[path] = result;
-			return result;
+			MeshCache::Store(sourcePath, flags, data);
+			return true;
 		}
 	
 		static shared_ptr<Material> LoadMaterial(const string& path, bool includeGeometryShader = false)
 		{
-			if (matCache.count(path))
+			if (auto material = matCache.Get(path))
 			{
-				return matCache[path];
+				return material;
 			}
 			string vertexCode = LoadText(defaultMaterialPath + path + ".vert");
 			if (vertexCode.length() == 0) vertexCode = LoadText(path + ".vert");
@@ -190,7 +221,7 @@ namespace VRThreads
 				}
 			}
 			auto result = make_shared<Material>(vertexCode, fragmentCode, geometryCode);
-			matCache[path] = result;
+			matCache.Put(path, result);
 			result->name = path;
 			return result;
 		}
@@ -222,11 +253,23 @@ namespace VRThreads
 			return code;
 		}
 
+		// Called between scenes. Materials and meshes stay cached, so switching or resetting a scene doesn't
+		// reload models or recompile shaders. Materials nobody references are reset to their loaded state,
+		// unreferenced meshes are evicted least recently used first once they exceed meshBudget.
+		static void ReleaseUnused()
+		{
+			matCache.ForEach([](const string& path, const shared_ptr<Material>& material) {
+				if (material.use_count() == 1) material->ResetState();
+			});
+			meshCache.Trim(meshBudget);
+			fmt::print("Info(Resource): {} materials, {} meshes ({:.1f} MB) cached\n", matCache.size(), meshCache.size(),
+				meshCache.memory() / (1024.0 * 1024.0));
+		}
+
 		static void ClearCache()
 		{
-			// only mat needs to be clear
-			matCache.clear();
-			meshCache.clear();
+			matCache.Clear();
+			meshCache.Clear();
 		}
 
 	private:
@@ -241,8 +284,9 @@ namespace VRThreads
 		}
 
 		static inline unordered_map<string, unsigned int> textureCache;
-		static inline unordered_map<string, shared_ptr<Mesh>> meshCache;
-		static inline unordered_map<string, shared_ptr<Material>> matCache;
+		static inline TextureLoader textureLoader;
+		static inline ResourceCache<Mesh> meshCache;
+		static inline ResourceCache<Material> matCache;
 
 		static inline string defaultTexturePath = "Assets/Texture/";
 		static inline string defaultMeshPath = "Assets/Model/";
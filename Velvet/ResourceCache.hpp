@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace VRThreads
+{
+	using namespace std;
+
+	/// <summary>
+	/// Keyed cache of shared resources ordered by last use. Entries that are still referenced outside of the cache
+	/// are never evicted, unreferenced entries are evicted least recently used first once together they exceed the budget.
+	/// </summary>
+	template <class T>
+	class ResourceCache
+	{
+	public:
+		// Returns null when the key isn't cached. A hit marks the entry as most recently used.
+		shared_ptr<T> Get(const string& key)
+		{
+			auto it = m_entries.find(key);
+			if (it == m_entries.end()) return nullptr;
+
+			m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+			return it->second.value;
+		}
+
+		// bytes is the memory accounted against the budget
+		void Put(const string& key, shared_ptr<T> value, size_t bytes = 0)
+		{
+			Erase(key);
+			m_lru.push_front(key);
+			m_entries[key] = { value, bytes, m_lru.begin() };
+			m_memory += bytes;
+		}
+
+		void Erase(const string& key)
+		{
+			auto it = m_entries.find(key);
+			if (it == m_entries.end()) return;
+
+			m_memory -= it->second.bytes;
+			m_lru.erase(it->second.lru);
+			m_entries.erase(it);
+		}
+
+		// Evicts unreferenced entries, least recently used first, until the unreferenced ones fit the budget.
+		// Referenced entries don't count against it, they can't be evicted anyway.
+		void Trim(size_t budget)
+		{
+			size_t unreferenced = 0;
+			for (const auto& entry : m_entries)
+			{
+				if (entry.second.value.use_count() == 1) unreferenced += entry.second.bytes;
+			}
+
+			for (auto it = m_lru.end(); it != m_lru.begin() && unreferenced > budget;)
+			{
+				--it;
+				auto& entry = m_entries[*it];
+				if (entry.value.use_count() > 1) continue;
+
+				unreferenced -= entry.bytes;
+				m_memory -= entry.bytes;
+				m_entries.erase(*it);
+				it = m_lru.erase(it);
+			}
+		}
+
+		void Clear()
+		{
+			m_entries.clear();
+			m_lru.clear();
+			m_memory = 0;
+		}
+
+		// func(key, value), most recently used first
+		template <class Func>
+		void ForEach(const Func& func) const
+		{
+			for (const auto& key : m_lru)
+			{
+				func(key, m_entries.at(key).value);
+			}
+		}
+
+		size_t size() const
+		{
+			return m_entries.size();
+		}
+
+		size_t memory() const
+		{
+			return m_memory;
+		}
+
+	private:
+		struct Entry
+		{
+			shared_ptr<T> value;
+			size_t bytes = 0;
+			typename list<string>::iterator lru;
+		};
+
+		unordered_map<string, Entry> m_entries;
+		list<string> m_lru; // most recently used first
+		size_t m_memory = 0;
+	};
+}
\ No newline at end of file
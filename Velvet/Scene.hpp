@@ -11,10 +11,14 @@
 #include "MeshRenderer.hpp"
 #include "MaterialProperty.hpp"
 #include "Collider.hpp"
+#include "MeshCollider.hpp"
+#include "DynamicMeshCollider.hpp"
 #include "VtClothObjectCPU.hpp"
 #include "VtClothObjectGPU.hpp"
+#include "VtClothPlayback.hpp"
 #include "ParticleInstancedRenderer.hpp"
 #include "ParticleGeometryRenderer.hpp"
+#include "VtHeadlessScene.hpp"
 
 //#define SOLVER_CPU
 
@@ -131,40 +135,9 @@ namespace VRThreads
 		// TODO OH: GenerateClothMeshFromObj
 		shared_ptr<Mesh> GenerateClothMesh(int resolution)
 		{
-			vector<glm::vec3> vertices;
-			vector<glm::vec3> normals;
-			vector<glm::vec2> uvs;
-			vector<unsigned int> indices;
-			const float clothSize = 2.0f;
-
-			for (int y = 0; y <= resolution; y++)
-			{
-				for (int x = 0; x <= resolution; x++)
-				{
-					vertices.push_back(clothSize * glm::vec3((float)x / (float)resolution - 0.5f, -(float)y / (float)resolution, 0));
-					normals.push_back(glm::vec3(0, 0, 1));
-					uvs.push_back(glm::vec2((float)x / (float)resolution, (float)y / (float)resolution));
-				}
-			}
-
-			auto VertexIndexAt = [resolution](int x, int y) {
-				return x * (resolution + 1) + y;
-			};
-
-			for (int x = 0; x < resolution; x++)
-			{
-				for (int y = 0; y < resolution; y++)
-				{
-					indices.push_back(VertexIndexAt(x, y));
-					indices.push_back(VertexIndexAt(x + 1, y));
-					indices.push_back(VertexIndexAt(x, y + 1));
-
-					indices.push_back(VertexIndexAt(x, y + 1));
-					indices.push_back(VertexIndexAt(x + 1, y));
-					indices.push_back(VertexIndexAt(x + 1, y + 1));
-				}
-			}
-			auto mesh = make_shared<Mesh>(vertices, normals, uvs, indices);
+			auto geometry = GenerateClothGeometry(resolution);
+			vector<glm::vec3> normals(geometry.positions.size(), glm::vec3(0, 0, 1));
+			auto mesh = make_shared<Mesh>(move(geometry.positions), move(normals), move(geometry.uvs), move(geometry.indices));
 			return mesh;
 		}
 
@@ -244,7 +217,7 @@ namespace VRThreads
 					}
 				}
 			}
-			auto mesh = make_shared<Mesh>(vertices, normals, uvs, indices);
+			auto mesh = make_shared<Mesh>(move(vertices), move(normals), move(uvs), move(indices));
 			return mesh;
 		}
 
@@ -255,6 +228,29 @@ namespace VRThreads
 
 			// TODO OH: Address non-homogeneous cloth springs
 
+			auto renderer = CreateClothRenderer(resolution, textureFile);
+
+			//auto prenderer = make_shared<ParticleRenderer>();
+			auto prenderer = make_shared<ParticleGeometryRenderer>();
+
+#ifdef SOLVER_CPU
+			auto clothObj = make_shared<VtClothObjectCPU>(resolution);
+#else
+			if (solver == nullptr)
+			{
+				solver = make_shared<VtClothSolverGPU>();
+				cloth->AddComponent(solver);
+			}
+			auto clothObj = make_shared<VtClothObjectGPU>(resolution, solver);
+#endif
+
+			cloth->AddComponents({ renderer, clothObj, prenderer });
+
+			return cloth;
+		}
+
+		shared_ptr<MeshRenderer> CreateClothRenderer(int resolution, int textureFile)
+		{
 			auto material = Resource::LoadMaterial("_Default");
 			material->Use();
 			material->doubleSided = true;
@@ -273,24 +269,7 @@ namespace VRThreads
 
 			auto renderer = make_shared<MeshRenderer>(mesh, material, true);
 			renderer->SetMaterialProperty(materialProperty);
-
-			//auto prenderer = make_shared<ParticleRenderer>();
-			auto prenderer = make_shared<ParticleGeometryRenderer>();
-
-#ifdef SOLVER_CPU
-			auto clothObj = make_shared<VtClothObject>(resolution);
-#else
-			if (solver == nullptr)
-			{
-				solver = make_shared<VtClothSolverGPU>();
-				cloth->AddComponent(solver);
-			}
-			auto clothObj = make_shared<VtClothObjectGPU>(resolution, solver);
-#endif
-
-			cloth->AddComponents({ renderer, clothObj, prenderer });
-
-			return cloth;
+			return renderer;
 		}
 
 		shared_ptr<Actor> SpawnSphere(GameInstance* game)
@@ -309,8 +288,7 @@ namespace VRThreads
 			auto renderer = make_shared<MeshRenderer>(mesh, material, true);
 			renderer->SetMaterialProperty(materialProperty);
 
-			// TODO OH: Here the collider is defined for a predefined type "Sphere". 
-			// SpawnMesh should use a new type Mesh / DynamicMesh to be implemented
+			// Analytic sphere, see SpawnMesh (MeshCollider) and DynamicMeshCollider for triangle meshes
 			auto collider = make_shared<Collider>(ColliderType::Sphere);
 			sphere->AddComponents({ renderer, collider });
 			return sphere;
@@ -376,5 +354,112 @@ namespace VRThreads
 			cube->AddComponents({ renderer, collider });
 			return cube;
 		}
+
+		// Static model that collides through the distance field of its triangles
+		shared_ptr<Actor> SpawnMesh(GameInstance* game, const string& path, glm::vec3 color = glm::vec3(1.0f))
+		{
+			auto actor = game->CreateActor(path);
+			auto material = Resource::LoadMaterial("_Default");
+
+			MaterialProperty materialProperty;
+			materialProperty.preRendering = [color](Material* mat) {
+				mat->SetVec3("material.tint", color);
+				mat->SetBool("material.useTexture", false);
+			};
+
+			auto mesh = Resource::LoadMesh(path);
+			auto renderer = make_shared<MeshRenderer>(mesh, material, true);
+			renderer->SetMaterialProperty(materialProperty);
+
+			auto collider = make_shared<MeshCollider>(mesh);
+			actor->AddComponents({ renderer, collider });
+			return actor;
+		}
+
+		// Spawns the cloths and colliders of a scene description and applies its parameters. The description is shared
+		// with velvet_headless and the benchmark, so the numbers of these scenes live in VtHeadlessScene::All only.
+		void SpawnDescription(GameInstance* game, const VtHeadlessScene& description)
+		{
+			for (const auto& p : description.intParams) ModifyParameter(&(Global::simParams.*p.first), p.second);
+			for (const auto& p : description.floatParams) ModifyParameter(&(Global::simParams.*p.first), p.second);
+			SpawnColliders(game, description);
+
+			shared_ptr<VtClothSolverGPU> solver;
+#ifndef SOLVER_CPU
+			if (description.sharedSolver)
+			{
+				auto solverActor = game->CreateActor("ClothSolver");
+				solver = make_shared<VtClothSolverGPU>();
+				solverActor->AddComponent(solver);
+			}
+#endif
+
+			for (const auto& desc : description.cloths)
+			{
+				auto cloth = SpawnCloth(game, desc.resolution, desc.texture, solver);
+				cloth->Initialize(desc.position, desc.scale, desc.rotation);
+				if (desc.attachedIndices.empty()) continue;
+
+#ifdef SOLVER_CPU
+				auto clothObj = cloth->GetComponent<VtClothObjectCPU>();
+#else
+				auto clothObj = cloth->GetComponent<VtClothObjectGPU>();
+#endif
+				if (clothObj) clothObj->SetAttachedIndices(desc.attachedIndices);
+			}
+		}
+
+		// Plays a bake of the description instead of simulating it, from velvet_headless --bake or from Bake Cache
+		// with a shared GPU solver. Both hold every cloth of the scene, in the order of the description.
+		void SpawnPlayback(GameInstance* game, const VtHeadlessScene& description, const string& path)
+		{
+			SpawnColliders(game, description);
+
+			int firstParticle = 0;
+			for (const auto& desc : description.cloths)
+			{
+				auto cloth = game->CreateActor("Cloth Playback");
+				auto renderer = CreateClothRenderer(desc.resolution, desc.texture);
+				cloth->AddComponents({ renderer, make_shared<VtClothPlayback>(path, firstParticle) });
+				firstParticle += (int)renderer->mesh()->vertices().size();
+			}
+		}
+
+		void SpawnColliders(GameInstance* game, const VtHeadlessScene& description)
+		{
+			for (const auto& collider : description.colliders)
+			{
+				shared_ptr<Actor> actor;
+				if (collider.type == ColliderType::Plane)
+				{
+					SpawnInfinitePlane(game);
+					continue;
+				}
+				else if (collider.type == ColliderType::Sphere)
+				{
+					actor = SpawnSphere(game);
+				}
+				else if (collider.type == ColliderType::Cube)
+				{
+					actor = SpawnColoredCube(game);
+				}
+				else
+				{
+					continue;
+				}
+				actor->Initialize(collider.position, collider.scale, collider.rotation);
+
+				if (collider.animate)
+				{
+					game->animationUpdate.Register([actor, state = collider]() mutable {
+						float time = Timer::fixedDeltaTime() * Timer::physicsFrameCount();
+						state.animate(state, time);
+						actor->transform->position = state.position;
+						actor->transform->scale = state.scale;
+						actor->transform->rotation = state.rotation;
+						});
+				}
+			}
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <filesystem>
+
+#include <glad/glad.h>
+#include <fmt/format.h>
+
+namespace VRThreads
+{
+	using namespace std;
+
+	// Linked shader programs on disk (glGetProgramBinary), so materials skip compiling and linking after the first run.
+	// A cache file (Cache/Shader/<key>.vtshader) is a ShaderCacheHeader followed by the driver's program binary.
+	// The key hashes the shader sources together with the renderer and driver version, and the driver may still
+	// reject a binary (e.g. after an update), in which case the material is compiled from source again.
+	struct ShaderCacheHeader
+	{
+		static const uint32_t k_version = 1;
+
+		char magic[4] = { 'V', 'T', 'S', 'B' };
+		uint32_t version = k_version;
+		uint64_t key = 0;
+		uint32_t format = 0;
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ShaderCacheHeader) == 24, "ShaderCacheHeader is part of the file format");
+
+	class ShaderCache
+	{
+	public:
+		static inline bool enabled = true;
+		static inline string directory = "Cache/Shader/";
+
+		// Program binaries need OpenGL 4.1 or ARB_get_program_binary, and at least one binary format
+		static bool supported()
+		{
+			static int s_supported = -1;
+			if (s_supported < 0)
+			{
+				s_supported = 0;
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+				bool available = false;
+#ifdef GL_VERSION_4_1
+				available |= GLAD_GL_VERSION_4_1 != 0;
+#endif
+#ifdef GL_ARB_get_program_binary
+				available |= GLAD_GL_ARB_get_program_binary != 0;
+#endif
+				GLint numFormats = 0;
+				if (available) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+				s_supported = numFormats > 0 ? 1 : 0;
+#endif
+			}
+			return s_supported == 1;
+		}
+
+		static uint64_t Key(const string& vertexCode, const string& fragmentCode, const string& geometryCode)
+		{
+			// FNV-1a of the sources and the driver, a separator keeps code moving between stages from colliding
+			uint64_t key = 14695981039346656037ull;
+			auto Mix = [&key](const char* text) {
+				for (; text && *text; text++)
+				{
+					key = (key ^ (uint8_t)*text) * 1099511628211ull;
+				}
+				key = (key ^ 0xff) * 1099511628211ull;
+			};
+			Mix(vertexCode.c_str());
+			Mix(fragmentCode.c_str());
+			Mix(geometryCode.c_str());
+			Mix((const char*)glGetString(GL_VENDOR));
+			Mix((const char*)glGetString(GL_RENDERER));
+			Mix((const char*)glGetString(GL_VERSION));
+			return key;
+		}
+
+		// Returns a linked program, or 0 when there is no cache or the driver rejects it
+		static unsigned int Load(uint64_t key)
+		{
+			if (!enabled || !supported()) return 0;
+
+			auto path = CachePath(key);
+			ifstream in(path, ios::binary);
+			if (!in) return 0;
+
+			ShaderCacheHeader header;
+			in.read((char*)&header, sizeof(header));
+			if (!in || memcmp(header.magic, "VTSB", 4) != 0 || header.version != ShaderCacheHeader::k_version || header.key != key)
+			{
+				return 0;
+			}
+			vector<char> binary(header.size);
+			in.read(binary.data(), binary.size());
+			if (!in) return 0;
+
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+			unsigned int program = glCreateProgram();
+			glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+			GLint success = 0;
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+			if (success) return program;
+
+			glDeleteProgram(program);
+			error_code error;
+			filesystem::remove(path, error);
+#endif
+			return 0;
+		}
+
+		// Call before linking, some drivers only keep the binary of programs that asked for it
+		static void SetRetrievable(unsigned int program)
+		{
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+			if (enabled && supported()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+		}
+
+		// Written to a temporary file first, so a second instance never reads a partial cache
+		static void Store(uint64_t key, unsigned int program)
+		{
+			if (!enabled || !supported()) return;
+
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+			GLint length = 0;
+			glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+			if (length <= 0) return;
+
+			ShaderCacheHeader header;
+			header.key = key;
+			vector<char> binary(length);
+			GLenum format = 0;
+			glGetProgramBinary(program, length, &length, &format, binary.data());
+			if (length <= 0) return;
+			header.format = format;
+			header.size = (uint32_t)length;
+
+			error_code error;
+			filesystem::create_directories(directory, error);
+			auto path = CachePath(key);
+			auto tempPath = fmt::format("{}.{}.tmp", path, hash<thread::id>()(this_thread::get_id()));
+			{
+				ofstream out(tempPath, ios::binary | ios::trunc);
+				if (!out) return;
+				out.write((const char*)&header, sizeof(header));
+				out.write(binary.data(), header.size);
+				if (!out.good())
+				{
+					out.close();
+					filesystem::remove(tempPath, error);
+					return;
+				}
+			}
+			filesystem::rename(tempPath, path, error);
+			if (error)
+			{
+				filesystem::remove(tempPath, error);
+			}
+#endif
+		}
+
+	private:
+		static string CachePath(uint64_t key)
+		{
+			return fmt::format("{}{:016x}.vtshader", directory, key);
+		}
+	};
+}
\ No newline at end of file
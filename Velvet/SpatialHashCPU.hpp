@@ -4,10 +4,23 @@
 #include <vector>
 #include <glm/glm.hpp>
 
+#include "VtThreadPool.hpp"
+
 namespace VRThreads
 {
 	using namespace std;
 
+	// Neighbors of one particle, a view into the flat neighbor list
+	struct NeighborRange
+	{
+		const int* first;
+		const int* last;
+
+		const int* begin() const { return first; }
+		const int* end() const { return last; }
+		int size() const { return (int)(last - first); }
+	};
+
 	class SpatialHashCPU
 	{
 	public:
@@ -17,65 +30,135 @@ namespace VRThreads
 			m_tableSize = 2 * maxNumObjects;
 			m_cellStart = vector<int>(m_tableSize + 1, 0);
 			m_cellEntries = vector<int>(maxNumObjects, 0);
-			m_neighbors = vector<vector<int>>(maxNumObjects);
+			m_entryHashes = vector<int>(maxNumObjects, 0);
+			m_neighborOffsets = vector<int>(maxNumObjects + 1, 0);
 		}
 
-		void HashObjects(const vector<glm::vec3>& positions)
+		// Sorts objects into cells (parallel radix sort of their hashes) and caches the neighbors within spacing of each object.
+		// All buffers keep their capacity between calls, and the result doesn't depend on the number of threads.
+		void HashObjects(const vector<glm::vec3>& positions, VtThreadPool& threadPool)
 		{
-			std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
-			std::fill(m_cellEntries.begin(), m_cellEntries.end(), 0);
+			int numObjects = (int)positions.size();
+			int numBlocks = threadPool.numThreads();
+			int blockSize = (numObjects + numBlocks - 1) / numBlocks;
+
+			m_entryHashes.resize(numObjects);
+			m_cellEntries.resize(numObjects);
+			m_sortHashes.resize(numObjects);
+			m_sortEntries.resize(numObjects);
+			m_blockCounts.resize((size_t)numBlocks * k_radix);
+
+			threadPool.ParallelFor(numObjects, [this, &positions](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					m_entryHashes[i] = HashPosition(positions[i]);
+					m_cellEntries[i] = i;
+				}
+				}, k_objectGrainSize);
 
-			// determine cell sizes
-			for (int i = 0; i < positions.size(); i++)
+			// Least significant digit first. Every pass is a stable counting sort of the objects by one digit, so objects
+			// stay ordered by id inside each cell, and the work is O(objects + threads * radix) per pass.
+			for (int shift = 0; ((m_tableSize - 1) >> shift) > 0; shift += k_radixBits)
 			{
-				int coords = HashPosition(positions[i]);
-				m_cellStart[coords]++;
-			}
+				threadPool.ParallelFor(numBlocks, [this, numObjects, blockSize, shift](int begin, int end, int) {
+					for (int block = begin; block < end; block++)
+					{
+						int* counts = m_blockCounts.data() + (size_t)block * k_radix;
+						fill(counts, counts + k_radix, 0);
+						for (int i = block * blockSize; i < min(numObjects, (block + 1) * blockSize); i++)
+						{
+							counts[(m_entryHashes[i] >> shift) & (k_radix - 1)]++;
+						}
+					}
+					}, 1);
 
-			// determine cell starts
-			int start = 0;
-			for (int i = 0; i < m_tableSize; i++)
-			{
-				start += m_cellStart[i];
-				m_cellStart[i] = start;
-			}
-			m_cellStart[m_tableSize] = start;
+				// turn block counts into the first slot of each block inside each digit
+				int slot = 0;
+				for (int digit = 0; digit < k_radix; digit++)
+				{
+					for (int block = 0; block < numBlocks; block++)
+					{
+						int& count = m_blockCounts[(size_t)block * k_radix + digit];
+						int blockCount = count;
+						count = slot;
+						slot += blockCount;
+					}
+				}
 
-			// fill in object ids
-			for (int i = 0; i < positions.size(); i++)
-			{
-				int coords = HashPosition(positions[i]);
-				m_cellStart[coords]--;
-				m_cellEntries[m_cellStart[coords]] = i;
+				threadPool.ParallelFor(numBlocks, [this, numObjects, blockSize, shift](int begin, int end, int) {
+					for (int block = begin; block < end; block++)
+					{
+						int* slots = m_blockCounts.data() + (size_t)block * k_radix;
+						for (int i = block * blockSize; i < min(numObjects, (block + 1) * blockSize); i++)
+						{
+							int slot = slots[(m_entryHashes[i] >> shift) & (k_radix - 1)]++;
+							m_sortHashes[slot] = m_entryHashes[i];
+							m_sortEntries[slot] = m_cellEntries[i];
+						}
+					}
+					}, 1);
+
+				swap(m_entryHashes, m_sortHashes);
+				swap(m_cellEntries, m_sortEntries);
 			}
 
-			CacheNeighbors(positions);
+			// each entry starts the cells between the hash of the previous entry and its own, the last one closes the table
+			if (numObjects == 0) fill(m_cellStart.begin(), m_cellStart.end(), 0);
+			threadPool.ParallelFor(numObjects, [this, numObjects](int begin, int end, int) {
+				for (int k = begin; k < end; k++)
+				{
+					int hash = m_entryHashes[k];
+					for (int cell = (k == 0 ? 0 : m_entryHashes[k - 1] + 1); cell <= hash; cell++)
+					{
+						m_cellStart[cell] = k;
+					}
+					if (k == numObjects - 1)
+					{
+						for (int cell = hash + 1; cell <= m_tableSize; cell++)
+						{
+							m_cellStart[cell] = numObjects;
+						}
+					}
+				}
+				}, k_objectGrainSize);
+
+			CacheNeighbors(positions, threadPool);
 		}
 
-		vector<int>& GetNeighbors(int i)
+		NeighborRange GetNeighbors(int i) const
 		{
-			return m_neighbors[i];
+			const int* indices = m_neighborIndices.data();
+			return { indices + m_neighborOffsets[i], indices + m_neighborOffsets[i + 1] };
 		}
 
 	private:
-		vector<int> m_cellEntries;
+		static constexpr int k_radixBits = 8;
+		static constexpr int k_radix = 1 << k_radixBits;
+		const int k_objectGrainSize = 256;
+
+		vector<int> m_cellEntries; // object ids sorted by cell
+		vector<int> m_entryHashes; // cell of each entry of m_cellEntries
 		vector<int> m_cellStart;
-		vector<vector<int>> m_neighbors;
+		vector<int> m_sortEntries; // the other half of each radix pass
+		vector<int> m_sortHashes;
+		vector<int> m_blockCounts; // [block][digit]
+		vector<int> m_neighborOffsets; // neighbors of object i are m_neighborIndices[offsets[i], offsets[i+1])
+		vector<int> m_neighborIndices;
 		int m_tableSize;
 		float m_spacing;
 
-		inline int ComputeIntCoord(float value)
+		inline int ComputeIntCoord(float value) const
 		{
 			return (int)floor(value / m_spacing);
 		}
 
-		inline int HashCoords(int x, int y, int z)
+		inline int HashCoords(int x, int y, int z) const
 		{
 			int h = (x * 92837111) ^ (y * 689287499) ^ (z * 283923481);	// fantasy function
-			return abs(h % m_tableSize); 
+			return abs(h % m_tableSize);
 		}
 
-		inline int HashPosition(glm::vec3 position)
+		inline int HashPosition(glm::vec3 position) const
 		{
 			int x = ComputeIntCoord(position.x);
 			int y = ComputeIntCoord(position.y);
@@ -85,22 +168,51 @@ namespace VRThreads
 			return h;
 		}
 
-		void CacheNeighbors(const vector<glm::vec3>& positions)
+		void CacheNeighbors(const vector<glm::vec3>& positions, VtThreadPool& threadPool)
 		{
-			for (int i = 0; i < positions.size(); i++)
+			int numObjects = (int)positions.size();
+
+			// count first, so that the flat list can be filled in parallel
+			threadPool.ParallelFor(numObjects, [this, &positions](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					int count = 0;
+					QueryNeighbors(positions, i, [&count](int) { count++; });
+					m_neighborOffsets[i + 1] = count;
+				}
+				}, k_objectGrainSize);
+
+			m_neighborOffsets[0] = 0;
+			for (int i = 0; i < numObjects; i++)
 			{
-				m_neighbors[i] = QueryNeighbors(positions[i]);
+				m_neighborOffsets[i + 1] += m_neighborOffsets[i];
 			}
+			m_neighborIndices.resize(m_neighborOffsets[numObjects]);
+
+			threadPool.ParallelFor(numObjects, [this, &positions](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					int* neighbors = m_neighborIndices.data() + m_neighborOffsets[i];
+					QueryNeighbors(positions, i, [&neighbors](int j) { *(neighbors++) = j; });
+				}
+				}, k_objectGrainSize);
 		}
 
-		vector<int> QueryNeighbors(glm::vec3 position)
+		// Calls func for every other object within spacing of object i
+		template <class TFunc>
+		void QueryNeighbors(const vector<glm::vec3>& positions, int i, TFunc func) const
 		{
-			vector<int> result;
+			glm::vec3 position = positions[i];
+			float radius2 = m_spacing * m_spacing;
 
 			int ix = ComputeIntCoord(position.x);
 			int iy = ComputeIntCoord(position.y);
 			int iz = ComputeIntCoord(position.z);
 
+			// different cells can share a hash entry, each entry is visited once
+			int visited[27];
+			int numVisited = 0;
+
 			for (int x = ix - 1; x <= ix + 1; x++)
 			{
 				for (int y = iy - 1; y <= iy + 1; y++)
@@ -108,18 +220,24 @@ namespace VRThreads
 					for (int z = iz - 1; z <= iz + 1; z++)
 					{
 						int h = HashCoords(x, y, z);
+						if (find(visited, visited + numVisited, h) != visited + numVisited) continue;
+						visited[numVisited++] = h;
+
 						int start = m_cellStart[h];
 						int end = m_cellStart[h + 1];
 
-						for (int i = start; i < end; i++)
+						for (int k = start; k < end; k++)
 						{
-							result.push_back(m_cellEntries[i]);
+							int j = m_cellEntries[k];
+							glm::vec3 diff = positions[j] - position;
+							if (j != i && glm::dot(diff, diff) < radius2)
+							{
+								func(j);
+							}
 						}
 					}
 				}
 			}
-
-			return result;
 		}
 	};
 }
\ No newline at end of file
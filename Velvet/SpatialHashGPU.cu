@@ -169,7 +169,7 @@ void VRThreads::HashObjects(
 	const HashParams params)
 {
 	{
-		ScopedTimerGPU timer("Solver_HashParticle");
+		ScopedTimerGPU timer(TIMER_ID("Solver_HashParticle"));
 
 		h_params = params;
 		checkCudaErrors(cudaMemcpyToSymbolAsync(d_params, &params, sizeof(HashParams)));
@@ -177,13 +177,13 @@ void VRThreads::HashObjects(
 	}
 
 	{
-		ScopedTimerGPU timer("Solver_HashSort");
+		ScopedTimerGPU timer(TIMER_ID("Solver_HashSort"));
 		int maxBit = (int)ceil(log2(h_params.tableSize));
 		Sort(particleHash, particleIndex, h_params.numObjects, maxBit);
 	}
 
 	{
-		ScopedTimerGPU timer("Solver_HashBuildCell");
+		ScopedTimerGPU timer(TIMER_ID("Solver_HashBuildCell"));
 		cudaMemsetAsync(cellStart, 0xffffffff, sizeof(uint) * (h_params.tableSize + 1));
 		uint numBlocks, numThreads;
 		ComputeGridSize(h_params.numObjects, numBlocks, numThreads);
@@ -191,7 +191,7 @@ void VRThreads::HashObjects(
 		CUDA_CALL_V(FindCellStart_Kernel, numBlocks, numThreads, smemSize)(cellStart, cellEnd, particleHash);
 	}
 	{
-		ScopedTimerGPU timer("Solver_HashCache");
+		ScopedTimerGPU timer(TIMER_ID("Solver_HashCache"));
 		CUDA_CALL(CacheNeighbors_Kernel, h_params.numObjects)(neighbors, particleIndex, cellStart, cellEnd,
 			positions, originalPositions);
 	}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstring>
+
+#include <glad/glad.h>
+#include <fmt/core.h>
+
+#include "External/stb_image.h"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	/// <summary>
+	/// Decodes textures on background threads and uploads them on the render thread through a pixel buffer object.
+	/// The texture object is created up front with a placeholder image, so its id can be handed out right away
+	/// and the real image replaces the placeholder in place once it is uploaded.
+	/// </summary>
+	class TextureLoader
+	{
+	public:
+		TextureLoader(int numThreads = 2)
+		{
+			m_numThreads = max(1, numThreads);
+		}
+
+		TextureLoader(const TextureLoader&) = delete;
+
+		~TextureLoader()
+		{
+			{
+				lock_guard<mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_wakeUp.notify_all();
+			for (auto& worker : m_workers)
+			{
+				worker.join();
+			}
+			for (auto& image : m_decoded)
+			{
+				stbi_image_free(image.data);
+			}
+			// the pixel buffer belongs to the OpenGL context, which is gone by now
+		}
+
+		// 1x1 grey texture with the sampling state of a loaded texture. Render thread only.
+		static unsigned int CreatePlaceholder()
+		{
+			const unsigned char grey[4] = { 128, 128, 128, 255 };
+			unsigned int texture;
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			return texture;
+		}
+
+		// Decodes the first of paths that can be read into texture
+		void Load(unsigned int texture, const vector<string>& paths)
+		{
+			{
+				lock_guard<mutex> lock(m_mutex);
+				if (m_workers.empty())
+				{
+					for (int i = 0; i < m_numThreads; i++)
+					{
+						m_workers.emplace_back([this]() { WorkerLoop(); });
+					}
+				}
+				m_jobs.push_back({ texture, paths });
+			}
+			m_wakeUp.notify_one();
+		}
+
+		// Uploads decoded images until budget bytes went to the GPU, at least one image per call. Render thread only.
+		void Upload(size_t budget)
+		{
+			size_t uploaded = 0;
+			while (uploaded == 0 || uploaded < budget)
+			{
+				DecodedImage image;
+				{
+					lock_guard<mutex> lock(m_mutex);
+					if (m_decoded.empty()) break;
+					image = m_decoded.front();
+					m_decoded.pop_front();
+				}
+
+				if (image.data)
+				{
+					uploaded += UploadImage(image);
+					stbi_image_free(image.data);
+				}
+				else
+				{
+					fmt::print("Error(Resource): Texture failed to load at path({})\n", image.path);
+				}
+			}
+		}
+
+	private:
+		struct Job
+		{
+			unsigned int texture;
+			vector<string> paths;
+		};
+
+		struct DecodedImage
+		{
+			unsigned int texture = 0;
+			string path;
+			unsigned char* data = nullptr;
+			int width = 0;
+			int height = 0;
+			int components = 0;
+		};
+
+		int m_numThreads = 2;
+		vector<thread> m_workers;
+		deque<Job> m_jobs;
+		deque<DecodedImage> m_decoded;
+		mutex m_mutex;
+		condition_variable m_wakeUp;
+		bool m_stop = false;
+
+		unsigned int m_pixelBuffer = 0;
+
+		void WorkerLoop()
+		{
+			while (true)
+			{
+				Job job;
+				{
+					unique_lock<mutex> lock(m_mutex);
+					m_wakeUp.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+					if (m_stop) return;
+					job = move(m_jobs.front());
+					m_jobs.pop_front();
+				}
+
+				DecodedImage image;
+				image.texture = job.texture;
+				image.path = job.paths.empty() ? "" : job.paths.front();
+				for (const auto& path : job.paths)
+				{
+					image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+					if (image.data) break;
+				}
+
+				lock_guard<mutex> lock(m_mutex);
+				m_decoded.push_back(image);
+			}
+		}
+
+		size_t UploadImage(const DecodedImage& image)
+		{
+			GLenum internalFormat = GL_RED;
+			GLenum dataFormat = GL_RED;
+			if (image.components == 2)
+			{
+				internalFormat = GL_RG;
+				dataFormat = GL_RG;
+			}
+			else if (image.components == 3)
+			{
+				internalFormat = GL_SRGB;
+				dataFormat = GL_RGB;
+			}
+			else if (image.components == 4)
+			{
+				internalFormat = GL_SRGB_ALPHA;
+				dataFormat = GL_RGBA;
+			}
+			size_t size = (size_t)image.width * image.height * image.components;
+
+			// orphaning the buffer lets the driver keep the previous upload in flight while this one is written
+			if (m_pixelBuffer == 0) glGenBuffers(1, &m_pixelBuffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			const void* pixels = nullptr; // offset into the pixel buffer
+			if (mapped)
+			{
+				memcpy(mapped, image.data, size);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+			else
+			{
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				pixels = image.data;
+			}
+
+			// rows of stb images are tightly packed
+			GLint alignment;
+			glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glBindTexture(GL_TEXTURE_2D, image.texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, dataFormat, GL_UNSIGNED_BYTE, pixels);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+			// other uploads read from client memory
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return size;
+		}
+	};
+}
\ No newline at end of file
@@ -2,19 +2,28 @@
 
 #include <iostream>
 #include <unordered_map>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <vector>
+#include <chrono>
 
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <fmt/printf.h>
 #include <cuda_runtime.h>
 
+#include "TraceBuffer.hpp"
+
 //#include "Global.hpp"
 
 using namespace std;
 
+// Interns the label once per call site, so timing a scope costs no string hashing after the first call.
+// e.g. ScopedTimerGPU timer(TIMER_ID("Solver_Predict"));
+#define TIMER_ID(label) ([]() { static const VRThreads::TimerId s_id = VRThreads::Timer::Intern(label); return s_id; }())
+
 namespace VRThreads
 {
+	using TimerId = int;
 
 	class Timer
 	{
@@ -24,104 +33,159 @@ namespace VRThreads
 		{
 			s_timer = this;
 
+			m_slots.reserve(k_maxTimers);
+			m_eventPool.reserve(k_maxTimers * 2);
 			m_lastUpdateTime = (float)CurrentTime();
 			m_fixedUpdateTimer = (float)CurrentTime();
 		}
 
 		~Timer()
 		{
-			for (const auto& label2events : cudaEvents)
+			for (auto& slot : m_slots)
 			{
-				for (auto& e : label2events.second)
-				{
-					cudaEventDestroy(e);
-				}
+				m_eventPool.insert(m_eventPool.end(), slot.events.begin(), slot.events.end());
 			}
+			for (auto e : m_eventPool)
+			{
+				cudaEventDestroy(e);
+			}
+		}
+
+		// Returns a process-wide id for the label. Ids stay valid when the Timer is recreated.
+		static TimerId Intern(const string& label)
+		{
+			lock_guard<mutex> lock(LabelMutex());
+			auto& ids = LabelIds();
+			auto it = ids.find(label);
+			if (it != ids.end()) return it->second;
+
+			auto& names = LabelNames();
+			TimerId id = (TimerId)names.size();
+			names.push_back(label);
+			ids[label] = id;
+			return id;
+		}
+
+		static const string& LabelName(TimerId id)
+		{
+			return LabelNames()[id];
+		}
+
+		static void StartTimer(TimerId id)
+		{
+			s_timer->Slot(id).start = CurrentTime();
 		}
 
 		static void StartTimer(const string& label)
 		{
-			s_timer->times[label] = CurrentTime();
+			StartTimer(Intern(label));
 		}
 
 		// Returns elapsed time from StartTimer in seconds.
 		// When called multiple time during one frame, result gets accumulated.
-		static double EndTimer(const string& label, int frame = -1)
+		static double EndTimer(TimerId id, int frame = -1)
 		{
-			double time = CurrentTime() - s_timer->times[label];
+			double end = CurrentTime();
+			auto& slot = s_timer->Slot(id);
+			if (slot.start < 0)
+			{
+				fmt::print("Warning(Timer): EndTimer with undefined label[{}].\n", LabelName(id));
+				return -1;
+			}
+
+			double time = end - slot.start;
 			if (frame == -1)
 			{
 				frame = s_timer->m_frameCount;
 			}
+			s_timer->m_trace.Complete(LabelName(id).c_str(), slot.start, end, frame);
 
-			if (s_timer->times.count(label))
+			if (frame > slot.frame)
 			{
-				if (frame > s_timer->frames[label])
-				{
-					s_timer->history[label] = time;
-				}
-				else
-				{
-					s_timer->history[label] += time;
-				}
-				s_timer->frames[label] = frame;
-				return s_timer->history[label];
+				slot.history = time;
 			}
 			else
 			{
-				fmt::print("Warning(Timer): EndTimer with undefined label[{}].\n", label);
-				return -1;
+				slot.history += time;
 			}
+			slot.frame = frame;
+			return slot.history;
+		}
+
+		static double EndTimer(const string& label, int frame = -1)
+		{
+			return EndTimer(Intern(label), frame);
 		}
 
 		// returns time in seconds
+		static double GetTimer(TimerId id)
+		{
+			return s_timer->Slot(id).history;
+		}
+
 		static double GetTimer(const string& label)
 		{
-			if (s_timer->history.count(label))
-			{
-				return s_timer->history[label];
-			}
-			else
-			{
-				return 0;
-			}
+			return GetTimer(Intern(label));
 		}
 
+		// Returns the time accumulated during the given frame in seconds, 0 if the label wasn't timed in that frame
+		static double GetTimer(TimerId id, int frame)
+		{
+			const auto& slot = s_timer->Slot(id);
+			return slot.frame == frame ? slot.history : 0;
+		}
+
+		static double GetTimer(const string& label, int frame)
+		{
+			return GetTimer(Intern(label), frame);
+		}
+
+		// Seconds since the first call. Uses no window system, so the solver also runs headless.
 		static double CurrentTime()
 		{
-			return glfwGetTime();
+			static const auto start = chrono::steady_clock::now();
+			return chrono::duration<double>(chrono::steady_clock::now() - start).count();
 		}
 	public:
-		static void StartTimerGPU(const string& label)
+		static void StartTimerGPU(TimerId id)
 		{
 			int frame = s_timer->m_frameCount;
+			auto& slot = s_timer->Slot(id);
 
-			if (s_timer->frames.count(label) && s_timer->frames[label] != frame)
+			if (slot.events.size() > 0 && slot.frame != frame)
 			{
-				GetTimerGPU(label);
+				GetTimerGPU(id);
 			}
-			s_timer->frames[label] = frame;
-
-			cudaEvent_t start, end;
-			cudaEventCreate(&start);
-			cudaEventCreate(&end);
-			auto& events = s_timer->cudaEvents[label];
-			events.push_back(start);
-			events.push_back(end);
+			slot.frame = frame;
+
+			auto start = s_timer->AcquireEvent();
+			auto end = s_timer->AcquireEvent();
+			slot.events.push_back(start);
+			slot.events.push_back(end);
 			cudaEventRecord(start);
 		}
 
+		static void StartTimerGPU(const string& label)
+		{
+			StartTimerGPU(Intern(label));
+		}
+
+		static void EndTimerGPU(TimerId id)
+		{
+			const auto& events = s_timer->Slot(id).events;
+			cudaEventRecord(events[events.size() - 1]);
+		}
+
 		static void EndTimerGPU(const string& label)
 		{
-			const auto& events = s_timer->cudaEvents[label];
-			auto stop = events[events.size() - 1];
-			cudaEventRecord(stop);
+			EndTimerGPU(Intern(label));
 		}
 
 		// return time in mili seconds
-		static double GetTimerGPU(const string& label)
+		static double GetTimerGPU(TimerId id)
 		{
-			auto& events = s_timer->cudaEvents[label];
+			auto& slot = s_timer->Slot(id);
+			auto& events = slot.events;
 			if (events.size() > 0)
 			{
 				auto lastEvent = events[events.size() - 1];
@@ -133,21 +197,19 @@ namespace VRThreads
 					float time;
 					cudaEventElapsedTime(&time, events[i], events[i + 1]);
 					totalTime += time;
-					cudaEventDestroy(events[i]);
-					cudaEventDestroy(events[i + 1]);
 				}
+				// events are reused by later timers instead of being destroyed
+				auto& pool = s_timer->m_eventPool;
+				pool.insert(pool.end(), events.begin(), events.end());
 				events.clear();
-				s_timer->history[label] = totalTime;
+				slot.history = totalTime / 1000.0;
 			}
+			return slot.history * 1000.0;
+		}
 
-			if (s_timer->history.count(label))
-			{
-				return s_timer->history[label];
-			}
-			else
-			{
-				return 0;
-			}
+		static double GetTimerGPU(const string& label)
+		{
+			return GetTimerGPU(Intern(label));
 		}
 	public:
 		static void UpdateDeltaTime()
@@ -162,6 +224,7 @@ namespace VRThreads
 		static void NextFrame()
 		{
 			s_timer->m_frameCount++;
+			s_timer->m_trace.Instant("Frame", CurrentTime(), s_timer->m_frameCount);
 			s_timer->m_elapsedTime += s_timer->m_deltaTime;
 		}
 
@@ -179,22 +242,50 @@ namespace VRThreads
 			return false;
 		}
 
-		static bool PeriodicUpdate(const string& label, float interval, bool allowRepetition = true)
+		static bool PeriodicUpdate(TimerId id, float interval, bool allowRepetition = true)
 		{
-			auto& l2t = s_timer->label2accumulatedTime;
-			if (!l2t.count(label))
-			{
-				l2t[label] = 0;
-			}
-
-			if (l2t[label] < s_timer->m_elapsedTime)
+			auto& next = s_timer->Slot(id).nextUpdate;
+			if (next < s_timer->m_elapsedTime)
 			{
-				l2t[label] = allowRepetition ? l2t[label] + interval : s_timer->m_elapsedTime + interval;
+				next = allowRepetition ? next + interval : s_timer->m_elapsedTime + interval;
 				return true;
 			}
 			return false;
 		}
 
+		static bool PeriodicUpdate(const string& label, float interval, bool allowRepetition = true)
+		{
+			return PeriodicUpdate(Intern(label), interval, allowRepetition);
+		}
+
+	public:
+		// Tracing records every timed scope into a ring buffer, see TraceBuffer
+		static void EnableTracing(bool enabled)
+		{
+			s_timer->m_trace.SetEnabled(enabled);
+		}
+
+		static bool tracing()
+		{
+			return s_timer->m_trace.enabled();
+		}
+
+		static void ClearTrace()
+		{
+			s_timer->m_trace.Clear();
+		}
+
+		// Writes the recorded events as Chrome trace-event JSON (Perfetto, chrome://tracing)
+		static bool WriteTrace(const string& path)
+		{
+			return s_timer->m_trace.WriteChromeTrace(path);
+		}
+
+		static void TraceScope(TimerId id, double start, double end)
+		{
+			s_timer->m_trace.Complete(LabelName(id).c_str(), start, end, s_timer->m_frameCount);
+		}
+
 		static auto frameCount()
 		{
 			return s_timer->m_frameCount;
@@ -221,12 +312,21 @@ namespace VRThreads
 		}
 	private:
 		static Timer* s_timer;
+		static const int k_maxTimers = 256;
 
-		unordered_map<string, double> times;
-		unordered_map<string, double> history;
-		unordered_map<string, int> frames;
-		unordered_map<string, vector<cudaEvent_t>> cudaEvents;
-		unordered_map<string, float> label2accumulatedTime;
+		struct TimerSlot
+		{
+			double start = -1;
+			double history = 0; // seconds
+			int frame = -1;
+			float nextUpdate = 0; // PeriodicUpdate
+			vector<cudaEvent_t> events; // pairs of start and end events recorded this frame
+		};
+
+		// indexed by TimerId, grows only when a new label shows up
+		vector<TimerSlot> m_slots;
+		vector<cudaEvent_t> m_eventPool;
+		TraceBuffer m_trace;
 
 		int m_frameCount = 0;
 		int m_physicsFrameCount = 0;
@@ -236,26 +336,92 @@ namespace VRThreads
 
 		float m_lastUpdateTime = 0.0f;
 		float m_fixedUpdateTimer = 0.0f;
+
+		TimerSlot& Slot(TimerId id)
+		{
+			if (id >= m_slots.size())
+			{
+				m_slots.resize(max((size_t)id + 1, LabelNames().size()));
+			}
+			return m_slots[id];
+		}
+
+		cudaEvent_t AcquireEvent()
+		{
+			cudaEvent_t e;
+			if (m_eventPool.size() > 0)
+			{
+				e = m_eventPool.back();
+				m_eventPool.pop_back();
+			}
+			else
+			{
+				cudaEventCreate(&e);
+			}
+			return e;
+		}
+
+		// deque keeps the names in place, the trace keeps pointers to them while recording
+		static deque<string>& LabelNames()
+		{
+			static deque<string> s_names;
+			return s_names;
+		}
+
+		static unordered_map<string, TimerId>& LabelIds()
+		{
+			static unordered_map<string, TimerId> s_ids;
+			return s_ids;
+		}
+
+		static mutex& LabelMutex()
+		{
+			static mutex s_mutex;
+			return s_mutex;
+		}
 	};
 
 
+	// CPU counterpart of ScopedTimerGPU
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(TimerId _id)
+		{
+			id = _id;
+			Timer::StartTimer(id);
+		}
+
+		~ScopedTimer()
+		{
+			Timer::EndTimer(id);
+		}
+
+	private:
+		TimerId id;
+	};
+
 	class ScopedTimerGPU
 	{
 	public:
-		ScopedTimerGPU(const string&& _label)
+		ScopedTimerGPU(TimerId _id)
 		{
 			//if (!Global::gameState.detailTimer) return;
-			label = _label;
-			Timer::StartTimerGPU(_label);
+			id = _id;
+			Timer::StartTimerGPU(id);
+			if (Timer::tracing()) start = Timer::CurrentTime();
 		}
 
 		~ScopedTimerGPU()
 		{
 			//if (!Global::gameState.detailTimer) return;
-			Timer::EndTimerGPU(label);
+			Timer::EndTimerGPU(id);
+			// kernels run asynchronously, the trace shows the time spent on launching them
+			if (Timer::tracing()) Timer::TraceScope(id, start, Timer::CurrentTime());
 		}
 
 	private:
-		string label;
+		TimerId id;
+		double start = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+
+#include <fmt/format.h>
+
+namespace VRThreads
+{
+	using namespace std;
+
+	struct TraceEvent
+	{
+		static const int k_maxNameLength = 47;
+
+		char name[k_maxNameLength + 1];
+		char phase; // 'X': complete event with duration, 'i': instant event
+		uint32_t threadId;
+		int frame;
+		double start; // seconds
+		double duration; // seconds
+	};
+
+	/// <summary>
+	/// Fixed size ring buffer of trace events, the oldest events are overwritten when full.
+	/// Recording is lock-free and doesn't allocate, so any thread can record at any time.
+	/// WriteChromeTrace() dumps the buffer in the Chrome trace-event format, which can be opened in Perfetto or chrome://tracing.
+	/// </summary>
+	class TraceBuffer
+	{
+	public:
+		// capacity is rounded up to a power of two
+		TraceBuffer(int capacity = 1 << 16)
+		{
+			int size = 1;
+			while (size < capacity) size *= 2;
+			m_mask = (uint64_t)size - 1;
+			m_slots = vector<Slot>(size);
+		}
+
+		TraceBuffer(const TraceBuffer&) = delete;
+
+		void SetEnabled(bool enabled)
+		{
+			m_enabled.store(enabled, memory_order_relaxed);
+		}
+
+		bool enabled() const
+		{
+			return m_enabled.load(memory_order_relaxed);
+		}
+
+		void Complete(const char* name, double start, double end, int frame)
+		{
+			if (!enabled()) return;
+			Push(name, 'X', start, end - start, frame);
+		}
+
+		void Instant(const char* name, double time, int frame)
+		{
+			if (!enabled()) return;
+			Push(name, 'i', time, 0, frame);
+		}
+
+		void Clear()
+		{
+			m_next.store(0, memory_order_relaxed);
+			for (auto& slot : m_slots)
+			{
+				slot.sequence.store(0, memory_order_relaxed);
+			}
+		}
+
+		// Copies the recorded events, oldest first. Events being overwritten while copying are skipped.
+		vector<TraceEvent> Snapshot() const
+		{
+			uint64_t end = m_next.load(memory_order_acquire);
+			uint64_t begin = end > m_slots.size() ? end - m_slots.size() : 0;
+
+			vector<TraceEvent> events;
+			events.reserve((size_t)(end - begin));
+			for (uint64_t index = begin; index < end; index++)
+			{
+				const auto& slot = m_slots[index & m_mask];
+				if (slot.sequence.load(memory_order_acquire) != index + 1) continue;
+				TraceEvent event = slot.event;
+				atomic_thread_fence(memory_order_acquire);
+				if (slot.sequence.load(memory_order_relaxed) != index + 1) continue;
+				events.push_back(event);
+			}
+			return events;
+		}
+
+		bool WriteChromeTrace(const string& path) const
+		{
+			ofstream out(path);
+			if (!out)
+			{
+				fmt::print("Error(Trace): Failed to open [{}].\n", path);
+				return false;
+			}
+
+			auto events = Snapshot();
+			out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+			for (int i = 0; i < events.size(); i++)
+			{
+				const auto& e = events[i];
+				// timestamps are in microseconds
+				if (e.phase == 'X')
+				{
+					out << fmt::format("{{\"name\": \"{}\", \"ph\": \"X\", \"ts\": {:.3f}, \"dur\": {:.3f}, \"pid\": 0, \"tid\": {}, \"args\": {{\"frame\": {}}}}}",
+						e.name, e.start * 1e6, e.duration * 1e6, e.threadId, e.frame);
+				}
+				else
+				{
+					out << fmt::format("{{\"name\": \"{}\", \"ph\": \"i\", \"s\": \"g\", \"ts\": {:.3f}, \"pid\": 0, \"tid\": {}, \"args\": {{\"frame\": {}}}}}",
+						e.name, e.start * 1e6, e.threadId, e.frame);
+				}
+				out << (i + 1 < events.size() ? ",\n" : "\n");
+			}
+			out << "]}\n";
+			fmt::print("Info(Trace): {} events written to [{}].\n", events.size(), path);
+			return true;
+		}
+
+		// Small stable id per thread, in order of the first recorded event
+		static uint32_t CurrentThreadId()
+		{
+			static atomic<uint32_t> s_nextThreadId = 0;
+			thread_local uint32_t threadId = s_nextThreadId.fetch_add(1, memory_order_relaxed);
+			return threadId;
+		}
+
+	private:
+		// sequence is index + 1 of the event stored in the slot, 0 while it is being written
+		struct Slot
+		{
+			atomic<uint64_t> sequence = 0;
+			TraceEvent event;
+
+			Slot() {}
+			Slot(const Slot&) {}
+		};
+
+		vector<Slot> m_slots;
+		uint64_t m_mask = 0;
+		atomic<uint64_t> m_next = 0;
+		atomic<bool> m_enabled = false;
+
+		void Push(const char* name, char phase, double start, double duration, int frame)
+		{
+			uint64_t index = m_next.fetch_add(1, memory_order_relaxed);
+			auto& slot = m_slots[index & m_mask];
+
+			slot.sequence.store(0, memory_order_relaxed);
+			atomic_thread_fence(memory_order_release);
+
+			auto& e = slot.event;
+			int length = 0;
+			for (; length < TraceEvent::k_maxNameLength && name[length] != '\0'; length++)
+			{
+				e.name[length] = name[length];
+			}
+			e.name[length] = '\0';
+			e.phase = phase;
+			e.threadId = CurrentThreadId();
+			e.frame = frame;
+			e.start = start;
+			e.duration = duration;
+
+			slot.sequence.store(index + 1, memory_order_release);
+		}
+	};
+}
\ No newline at end of file
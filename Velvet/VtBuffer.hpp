@@ -1,5 +1,8 @@
 #pragma once
 
+#include <glad/glad.h>
+#include <cuda_gl_interop.h>
+
 #include "Common.cuh"
 
 namespace VRThreads
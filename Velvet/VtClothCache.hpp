@@ -0,0 +1,775 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <fmt/format.h>
+
+#include "MappedFile.hpp"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	// Cloth cache (.vtc) layout, little endian:
+	//   VtCacheHeader                   64 bytes
+	//   frame records                   each starts on a 16 byte boundary
+	//   VtCacheFrameEntry[numFrames]    frame index table at header.indexOffset, written when the bake finishes
+	//
+	// Frame records by encoding (n = numParticles, normals only with VtCacheFlags::Normals):
+	//   Raw:       float3 positions[n], float3 normals[n]
+	//   Quantized: float3 min, float3 extent, uint16x3 positions[n], int16x2 normals[n]
+	//   Delta:     key frames store int32x3 positions[n] on a grid of quantizationStep followed by int16x2 normals[n],
+	//              delta frames store blocks of the position residuals to a linear prediction from the two previous frames,
+	//              then blocks of the normal residuals to the previous frame. A chunk is a key frame and the delta frames after it.
+	// Quantized normals use the octahedral mapping.
+	//
+	// Residual blocks hold k_blockValues zigzag coded values. A block starts with a byte, 0x80 | (count - 1) for a run of
+	// count blocks that are all zero, otherwise the bit width of its values, which follow packed little endian and padded
+	// to a byte. Particles at rest cost one byte per 128 blocks, slow ones a few bits per value.
+
+	enum class VtCacheEncoding : uint32_t
+	{
+		Raw = 0,
+		Quantized = 1,
+		Delta = 2,
+	};
+
+	enum class VtCacheFrameType : uint32_t
+	{
+		Raw = 0,
+		Quantized = 1,
+		Key = 2,
+		Delta = 3,
+	};
+
+	namespace VtCacheFlags
+	{
+		const uint32_t Normals = 1;
+	}
+
+	struct VtCacheHeader
+	{
+		static const uint32_t k_version = 2;
+
+		char magic[4] = { 'V', 'T', 'C', 'C' };
+		uint32_t version = k_version;
+		uint32_t encoding = 0;
+		uint32_t flags = 0;
+		uint32_t numParticles = 0;
+		uint32_t numFrames = 0;
+		float frameRate = 0;
+		float quantizationStep = 0;
+		uint64_t topologyHash = 0;
+		uint64_t indexOffset = 0;
+		uint32_t keyframeInterval = 0;
+		uint32_t reserved[3] = {};
+	};
+	static_assert(sizeof(VtCacheHeader) == 64, "VtCacheHeader is part of the file format");
+
+	struct VtCacheFrameEntry
+	{
+		uint64_t offset;
+		uint32_t size;
+		uint32_t type; // VtCacheFrameType
+		uint32_t keyframe; // first frame of the chunk
+		uint32_t reserved;
+	};
+	static_assert(sizeof(VtCacheFrameEntry) == 24, "VtCacheFrameEntry is part of the file format");
+
+	namespace VtCacheCodec
+	{
+		// FNV-1a over the particle count and triangle indices, playback rejects caches of another mesh
+		inline uint64_t TopologyHash(size_t numParticles, const unsigned int* indices, size_t numIndices)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			auto Mix = [&hash](uint32_t value) {
+				for (int i = 0; i < 4; i++)
+				{
+					hash ^= (value >> (i * 8)) & 0xff;
+					hash *= 1099511628211ull;
+				}
+			};
+			Mix((uint32_t)numParticles);
+			for (size_t i = 0; i < numIndices; i++) Mix(indices[i]);
+			return hash;
+		}
+
+		inline void EncodeNormal(glm::vec3 n, int16_t* out)
+		{
+			float sum = fabs(n.x) + fabs(n.y) + fabs(n.z);
+			if (sum > 0) n /= sum;
+			float x = n.x, y = n.y;
+			if (n.z < 0)
+			{
+				x = (1 - fabs(n.y)) * (n.x >= 0 ? 1.0f : -1.0f);
+				y = (1 - fabs(n.x)) * (n.y >= 0 ? 1.0f : -1.0f);
+			}
+			out[0] = (int16_t)lroundf(glm::clamp(x, -1.0f, 1.0f) * 32767.0f);
+			out[1] = (int16_t)lroundf(glm::clamp(y, -1.0f, 1.0f) * 32767.0f);
+		}
+
+		inline glm::vec3 DecodeNormal(const int16_t* in)
+		{
+			glm::vec3 n(in[0] / 32767.0f, in[1] / 32767.0f, 0);
+			n.z = 1 - fabs(n.x) - fabs(n.y);
+			if (n.z < 0)
+			{
+				float x = n.x;
+				n.x = (1 - fabs(n.y)) * (x >= 0 ? 1.0f : -1.0f);
+				n.y = (1 - fabs(x)) * (n.y >= 0 ? 1.0f : -1.0f);
+			}
+			float length = glm::length(n);
+			return length > 0 ? n / length : glm::vec3(0, 1, 0);
+		}
+
+		const int k_blockValues = 64;
+		const int k_maxZeroRun = 128;
+
+		inline uint64_t ZigZag(int64_t value)
+		{
+			return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+		}
+
+		inline int64_t UnZigZag(uint64_t value)
+		{
+			return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+		}
+
+		// Bits needed by the widest value of the block
+		inline int BlockWidth(const int64_t* values, size_t count)
+		{
+			uint64_t bits = 0;
+			for (size_t i = 0; i < count; i++) bits |= ZigZag(values[i]);
+			int width = 0;
+			while (bits)
+			{
+				width++;
+				bits >>= 1;
+			}
+			return width;
+		}
+
+		// Appends the residual blocks of values, see the layout above
+		inline void PutBlocks(vector<uint8_t>& out, const int64_t* values, size_t count)
+		{
+			size_t numBlocks = (count + k_blockValues - 1) / k_blockValues;
+			auto BlockSize = [count](size_t block) { return min((size_t)k_blockValues, count - block * k_blockValues); };
+
+			for (size_t block = 0; block < numBlocks;)
+			{
+				int width = BlockWidth(values + block * k_blockValues, BlockSize(block));
+				if (width == 0)
+				{
+					int run = 1;
+					while (block + run < numBlocks && run < k_maxZeroRun && BlockWidth(values + (block + run) * k_blockValues, BlockSize(block + run)) == 0)
+					{
+						run++;
+					}
+					out.push_back((uint8_t)(0x80 | (run - 1)));
+					block += run;
+					continue;
+				}
+
+				out.push_back((uint8_t)width);
+				uint64_t bits = 0;
+				int numBits = 0;
+				auto PutBits = [&out, &bits, &numBits](uint64_t value, int width) {
+					bits |= value << numBits;
+					numBits += width;
+					while (numBits >= 8)
+					{
+						out.push_back((uint8_t)bits);
+						bits >>= 8;
+						numBits -= 8;
+					}
+				};
+				for (size_t i = block * k_blockValues; i < block * k_blockValues + BlockSize(block); i++)
+				{
+					// at most 32 bits at once, so the pending bits never overflow
+					uint64_t zigzag = ZigZag(values[i]);
+					PutBits(zigzag & 0xffffffffull, min(width, 32));
+					if (width > 32) PutBits(zigzag >> 32, width - 32);
+				}
+				if (numBits > 0) out.push_back((uint8_t)bits);
+				block++;
+			}
+		}
+
+		// Reads count values written by PutBlocks. Returns false when the record ends in the middle of a block.
+		inline bool GetBlocks(const uint8_t*& in, const uint8_t* end, int64_t* values, size_t count)
+		{
+			size_t numBlocks = (count + k_blockValues - 1) / k_blockValues;
+			for (size_t block = 0; block < numBlocks;)
+			{
+				if (in >= end) return false;
+				uint8_t header = *in++;
+				if (header & 0x80)
+				{
+					size_t run = (header & 0x7f) + 1;
+					if (block + run > numBlocks) return false;
+					size_t first = block * k_blockValues;
+					fill(values + first, values + min(count, (block + run) * k_blockValues), 0);
+					block += run;
+					continue;
+				}
+
+				int width = header;
+				size_t first = block * k_blockValues;
+				size_t last = min(count, first + k_blockValues);
+				if (width > 64 || (size_t)(end - in) < ((last - first) * width + 7) / 8) return false;
+
+				uint64_t bits = 0;
+				int numBits = 0;
+				auto GetBits = [&in, &bits, &numBits](int width) {
+					while (numBits < width)
+					{
+						bits |= (uint64_t)*in++ << numBits;
+						numBits += 8;
+					}
+					uint64_t value = bits & ((1ull << width) - 1);
+					bits >>= width;
+					numBits -= width;
+					return value;
+				};
+				for (size_t i = first; i < last; i++)
+				{
+					uint64_t zigzag = GetBits(min(width, 32));
+					if (width > 32) zigzag |= GetBits(width - 32) << 32;
+					values[i] = UnZigZag(zigzag);
+				}
+				block++;
+			}
+			return true;
+		}
+
+		template <class T>
+		void Put(vector<uint8_t>& out, const T* data, size_t count)
+		{
+			size_t offset = out.size();
+			out.resize(offset + count * sizeof(T));
+			memcpy(out.data() + offset, data, count * sizeof(T));
+		}
+	}
+
+	/// <summary>
+	/// Streams simulated frames into a cloth cache. Frames go to disk as they are written,
+	/// the frame index table and the final header are written by Close().
+	/// </summary>
+	class VtClothCacheWriter
+	{
+	public:
+		VtClothCacheWriter() {}
+
+		VtClothCacheWriter(const VtClothCacheWriter&) = delete;
+
+		~VtClothCacheWriter()
+		{
+			Close();
+		}
+
+		// quantizationStep is in world units, keyframeInterval is the chunk length of the Delta encoding
+		bool Open(const string& path, int numParticles, const unsigned int* indices, size_t numIndices, float frameRate,
+			VtCacheEncoding encoding = VtCacheEncoding::Delta, bool writeNormals = true, float quantizationStep = 1e-4f, int keyframeInterval = 60)
+		{
+			Close();
+			m_out.open(path, ios::binary | ios::trunc);
+			if (!m_out)
+			{
+				fmt::print("Error(ClothCache): Failed to open [{}].\n", path);
+				return false;
+			}
+
+			m_path = path;
+			m_header = VtCacheHeader();
+			m_header.encoding = (uint32_t)encoding;
+			m_header.flags = writeNormals ? VtCacheFlags::Normals : 0;
+			m_header.numParticles = numParticles;
+			m_header.frameRate = frameRate;
+			m_header.quantizationStep = quantizationStep;
+			m_header.topologyHash = VtCacheCodec::TopologyHash(numParticles, indices, numIndices);
+			m_header.keyframeInterval = max(1, keyframeInterval);
+			m_index.clear();
+			m_chunkStart = 0;
+
+			// the header is rewritten with the frame count and index offset when closing
+			m_out.write((const char*)&m_header, sizeof(m_header));
+			return true;
+		}
+
+		bool Open(const string& path, const vector<unsigned int>& indices, int numParticles, float frameRate,
+			VtCacheEncoding encoding = VtCacheEncoding::Delta, bool writeNormals = true, float quantizationStep = 1e-4f, int keyframeInterval = 60)
+		{
+			return Open(path, numParticles, indices.data(), indices.size(), frameRate, encoding, writeNormals, quantizationStep, keyframeInterval);
+		}
+
+		// normals can be null, caches with normals then store the up vector
+		void WriteFrame(const glm::vec3* positions, const glm::vec3* normals = nullptr)
+		{
+			if (!isOpen()) return;
+
+			int frame = (int)m_index.size();
+			VtCacheFrameEntry entry = {};
+			entry.keyframe = frame;
+			m_record.clear();
+
+			switch ((VtCacheEncoding)m_header.encoding)
+			{
+			case VtCacheEncoding::Raw:
+				entry.type = (uint32_t)VtCacheFrameType::Raw;
+				EncodeRaw(positions, normals);
+				break;
+			case VtCacheEncoding::Quantized:
+				entry.type = (uint32_t)VtCacheFrameType::Quantized;
+				EncodeQuantized(positions, normals);
+				break;
+			case VtCacheEncoding::Delta:
+				entry.type = (uint32_t)EncodeDelta(frame, positions, normals);
+				entry.keyframe = m_chunkStart;
+				break;
+			}
+
+			// 16 byte alignment keeps Raw frames directly usable from a mapped file
+			static const char k_padding[16] = {};
+			auto offset = (uint64_t)m_out.tellp();
+			auto aligned = (offset + 15) & ~(uint64_t)15;
+			m_out.write(k_padding, aligned - offset);
+
+			entry.offset = aligned;
+			entry.size = (uint32_t)m_record.size();
+			m_out.write((const char*)m_record.data(), m_record.size());
+			m_index.push_back(entry);
+		}
+
+		void WriteFrame(const vector<glm::vec3>& positions, const vector<glm::vec3>& normals)
+		{
+			WriteFrame(positions.data(), normals.empty() ? nullptr : normals.data());
+		}
+
+		// Writes the frame index and the final header. Returns false if any write failed.
+		bool Close()
+		{
+			if (!isOpen()) return true;
+
+			m_header.numFrames = (uint32_t)m_index.size();
+			m_header.indexOffset = (uint64_t)m_out.tellp();
+			m_out.write((const char*)m_index.data(), m_index.size() * sizeof(VtCacheFrameEntry));
+			uint64_t fileSize = (uint64_t)m_out.tellp();
+			m_out.seekp(0);
+			m_out.write((const char*)&m_header, sizeof(m_header));
+
+			bool good = m_out.good();
+			m_out.close();
+			if (good)
+			{
+				fmt::print("Info(ClothCache): {} frames ({:.1f} MB) written to [{}].\n", m_header.numFrames, fileSize / (1024.0 * 1024.0), m_path);
+			}
+			else
+			{
+				fmt::print("Error(ClothCache): Failed to write [{}].\n", m_path);
+			}
+			return good;
+		}
+
+		bool isOpen() const
+		{
+			return m_out.is_open();
+		}
+
+		int numFrames() const
+		{
+			return (int)m_index.size();
+		}
+
+	private:
+		ofstream m_out;
+		string m_path;
+		VtCacheHeader m_header;
+		vector<VtCacheFrameEntry> m_index;
+		vector<uint8_t> m_record;
+
+		// Delta encoding state: grid positions of the current and the two previous frames, normals of the previous frame
+		vector<int32_t> m_quantized;
+		vector<int32_t> m_previous;
+		vector<int32_t> m_previous2;
+		vector<int16_t> m_normals;
+		vector<int16_t> m_previousNormals;
+		vector<int64_t> m_residuals;
+		int m_chunkStart = 0;
+
+		bool hasNormals() const
+		{
+			return (m_header.flags & VtCacheFlags::Normals) != 0;
+		}
+
+		void EncodeRaw(const glm::vec3* positions, const glm::vec3* normals)
+		{
+			VtCacheCodec::Put(m_record, positions, m_header.numParticles);
+			if (!hasNormals()) return;
+			if (normals)
+			{
+				VtCacheCodec::Put(m_record, normals, m_header.numParticles);
+			}
+			else
+			{
+				vector<glm::vec3> up(m_header.numParticles, glm::vec3(0, 1, 0));
+				VtCacheCodec::Put(m_record, up.data(), up.size());
+			}
+		}
+
+		void EncodeQuantized(const glm::vec3* positions, const glm::vec3* normals)
+		{
+			int n = m_header.numParticles;
+			glm::vec3 lower(0), upper(0);
+			if (n > 0) lower = upper = positions[0];
+			for (int i = 1; i < n; i++)
+			{
+				lower = glm::min(lower, positions[i]);
+				upper = glm::max(upper, positions[i]);
+			}
+			glm::vec3 extent = upper - lower;
+			VtCacheCodec::Put(m_record, &lower, 1);
+			VtCacheCodec::Put(m_record, &extent, 1);
+
+			vector<uint16_t> values(n * 3);
+			for (int i = 0; i < n; i++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					float t = extent[c] > 0 ? (positions[i][c] - lower[c]) / extent[c] : 0.0f;
+					values[i * 3 + c] = (uint16_t)lroundf(glm::clamp(t, 0.0f, 1.0f) * 65535.0f);
+				}
+			}
+			VtCacheCodec::Put(m_record, values.data(), values.size());
+			EncodeNormals(normals);
+		}
+
+		VtCacheFrameType EncodeDelta(int frame, const glm::vec3* positions, const glm::vec3* normals)
+		{
+			int n = m_header.numParticles;
+			float invStep = 1.0f / m_header.quantizationStep;
+			m_quantized.resize(n * 3);
+			for (int i = 0; i < n; i++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					m_quantized[i * 3 + c] = (int32_t)llround((double)positions[i][c] * invStep);
+				}
+			}
+
+			int frameInChunk = frame - m_chunkStart;
+			bool key = frame == 0 || frameInChunk >= (int)m_header.keyframeInterval;
+			if (key)
+			{
+				m_chunkStart = frame;
+				VtCacheCodec::Put(m_record, m_quantized.data(), m_quantized.size());
+				EncodeNormals(normals);
+			}
+			else
+			{
+				m_residuals.resize(n * 3);
+				for (int i = 0; i < n * 3; i++)
+				{
+					int64_t prediction = frameInChunk >= 2 ? 2 * (int64_t)m_previous[i] - m_previous2[i] : m_previous[i];
+					m_residuals[i] = m_quantized[i] - prediction;
+				}
+				VtCacheCodec::PutBlocks(m_record, m_residuals.data(), m_residuals.size());
+
+				if (hasNormals())
+				{
+					QuantizeNormals(normals);
+					m_residuals.resize(n * 2);
+					for (int i = 0; i < n * 2; i++)
+					{
+						m_residuals[i] = (int64_t)m_normals[i] - m_previousNormals[i];
+					}
+					VtCacheCodec::PutBlocks(m_record, m_residuals.data(), m_residuals.size());
+				}
+			}
+
+			swap(m_previous2, m_previous);
+			m_previous = m_quantized;
+			swap(m_previousNormals, m_normals);
+			return key ? VtCacheFrameType::Key : VtCacheFrameType::Delta;
+		}
+
+		void QuantizeNormals(const glm::vec3* normals)
+		{
+			m_normals.resize(m_header.numParticles * 2);
+			for (uint32_t i = 0; i < m_header.numParticles; i++)
+			{
+				VtCacheCodec::EncodeNormal(normals ? normals[i] : glm::vec3(0, 1, 0), m_normals.data() + i * 2);
+			}
+		}
+
+		void EncodeNormals(const glm::vec3* normals)
+		{
+			if (!hasNormals()) return;
+			QuantizeNormals(normals);
+			VtCacheCodec::Put(m_record, m_normals.data(), m_normals.size());
+		}
+	};
+
+	/// <summary>
+	/// Random access to a cloth cache through a memory mapping. Raw frames are used in place,
+	/// Delta frames are decoded from the start of their chunk unless the previous frame was just read.
+	/// </summary>
+	class VtClothCacheReader
+	{
+	public:
+		bool Open(const string& path)
+		{
+			Close();
+			if (!m_file.Open(path)) return false;
+
+			auto Fail = [this, &path](const char* reason) {
+				fmt::print("Error(ClothCache): [{}] {}.\n", path, reason);
+				Close();
+				return false;
+			};
+
+			if (m_file.size() < sizeof(VtCacheHeader)) return Fail("is too small");
+			m_header = (const VtCacheHeader*)m_file.data();
+			if (memcmp(m_header->magic, "VTCC", 4) != 0) return Fail("is not a cloth cache");
+			if (m_header->version != VtCacheHeader::k_version) return Fail("has an unsupported version");
+			if (m_header->encoding > (uint32_t)VtCacheEncoding::Delta) return Fail("has an unknown encoding");
+			if (m_header->indexOffset == 0 || m_header->indexOffset + (uint64_t)m_header->numFrames * sizeof(VtCacheFrameEntry) > m_file.size())
+			{
+				return Fail("has no complete frame index, the bake may not have finished");
+			}
+			m_index = (const VtCacheFrameEntry*)(m_file.data() + m_header->indexOffset);
+			m_decodedFrame = -1;
+			return true;
+		}
+
+		void Close()
+		{
+			m_file.Close();
+			m_header = nullptr;
+			m_index = nullptr;
+			m_decodedFrame = -1;
+		}
+
+		bool isOpen() const
+		{
+			return m_header != nullptr;
+		}
+
+		int numFrames() const { return m_header ? m_header->numFrames : 0; }
+
+		int numParticles() const { return m_header ? m_header->numParticles : 0; }
+
+		float frameRate() const { return m_header ? m_header->frameRate : 0; }
+
+		uint64_t topologyHash() const { return m_header ? m_header->topologyHash : 0; }
+
+		VtCacheEncoding encoding() const { return (VtCacheEncoding)m_header->encoding; }
+
+		bool hasNormals() const
+		{
+			return m_header && (m_header->flags & VtCacheFlags::Normals) != 0;
+		}
+
+		// Positions of a Raw frame inside the mapping, null for other encodings
+		const glm::vec3* RawPositions(int frame) const
+		{
+			auto record = RawRecord(frame);
+			return record ? (const glm::vec3*)record : nullptr;
+		}
+
+		const glm::vec3* RawNormals(int frame) const
+		{
+			auto record = RawRecord(frame);
+			return record && hasNormals() ? (const glm::vec3*)record + m_header->numParticles : nullptr;
+		}
+
+		// Decodes a frame. Normals are left untouched when the cache has none.
+		bool ReadFrame(int frame, vector<glm::vec3>& positions, vector<glm::vec3>* normals = nullptr)
+		{
+			if (!isOpen() || frame < 0 || frame >= numFrames()) return false;
+
+			int n = m_header->numParticles;
+			positions.resize(n);
+			const auto& entry = m_index[frame];
+			switch ((VtCacheFrameType)entry.type)
+			{
+			case VtCacheFrameType::Raw:
+			{
+				auto record = Record(entry);
+				if (!record) return false;
+				memcpy(positions.data(), record, n * sizeof(glm::vec3));
+				if (normals && hasNormals())
+				{
+					normals->resize(n);
+					memcpy(normals->data(), record + n * sizeof(glm::vec3), n * sizeof(glm::vec3));
+				}
+				return true;
+			}
+			case VtCacheFrameType::Quantized:
+			{
+				auto record = Record(entry);
+				if (!record) return false;
+				glm::vec3 lower, extent;
+				memcpy(&lower, record, sizeof(glm::vec3));
+				memcpy(&extent, record + sizeof(glm::vec3), sizeof(glm::vec3));
+				const uint16_t* values = (const uint16_t*)(record + 2 * sizeof(glm::vec3));
+				for (int i = 0; i < n; i++)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						positions[i][c] = lower[c] + extent[c] * (values[i * 3 + c] / 65535.0f);
+					}
+				}
+				DecodeNormals((const int16_t*)(values + n * 3), normals);
+				return true;
+			}
+			case VtCacheFrameType::Key:
+			case VtCacheFrameType::Delta:
+				return ReadDeltaFrame(frame, positions, normals);
+			}
+			return false;
+		}
+
+	private:
+		MappedFile m_file;
+		const VtCacheHeader* m_header = nullptr;
+		const VtCacheFrameEntry* m_index = nullptr;
+
+		// grid positions of the last two decoded Delta frames and normals of the last one
+		vector<int32_t> m_quantized;
+		vector<int32_t> m_previous;
+		vector<int16_t> m_normals;
+		vector<int64_t> m_residuals;
+		int m_decodedFrame = -1;
+
+		// Returns the record of the frame if it lies inside the file and has the size its type requires
+		const uint8_t* Record(const VtCacheFrameEntry& entry) const
+		{
+			if (entry.offset + entry.size > m_file.size()) return nullptr;
+			size_t n = m_header->numParticles;
+			size_t expected = 0;
+			switch ((VtCacheFrameType)entry.type)
+			{
+			case VtCacheFrameType::Raw:
+				expected = n * sizeof(glm::vec3) * (hasNormals() ? 2 : 1);
+				break;
+			case VtCacheFrameType::Quantized:
+				expected = 2 * sizeof(glm::vec3) + n * 3 * sizeof(uint16_t) + normalSize();
+				break;
+			case VtCacheFrameType::Key:
+				expected = n * 3 * sizeof(int32_t) + normalSize();
+				break;
+			case VtCacheFrameType::Delta:
+				// residual blocks have no fixed size, GetBlocks checks the bounds
+				return m_file.data() + entry.offset;
+			}
+			return entry.size == expected ? m_file.data() + entry.offset : nullptr;
+		}
+
+		const uint8_t* RawRecord(int frame) const
+		{
+			if (!isOpen() || frame < 0 || frame >= numFrames()) return nullptr;
+			const auto& entry = m_index[frame];
+			if (entry.type != (uint32_t)VtCacheFrameType::Raw) return nullptr;
+			return Record(entry);
+		}
+
+		void DecodeNormals(const int16_t* values, vector<glm::vec3>* normals) const
+		{
+			if (!normals || !hasNormals()) return;
+			int n = m_header->numParticles;
+			normals->resize(n);
+			for (int i = 0; i < n; i++)
+			{
+				(*normals)[i] = VtCacheCodec::DecodeNormal(values + i * 2);
+			}
+		}
+
+		bool ReadDeltaFrame(int frame, vector<glm::vec3>& positions, vector<glm::vec3>* normals)
+		{
+			int keyframe = m_index[frame].keyframe;
+			if (keyframe > frame) return false;
+
+			// continue from the last decoded frame when it belongs to the same chunk
+			int first = (m_decodedFrame >= keyframe && m_decodedFrame <= frame) ? m_decodedFrame + 1 : keyframe;
+			for (int f = first; f <= frame; f++)
+			{
+				if (!DecodeDelta(f, keyframe)) return false;
+			}
+
+			int n = m_header->numParticles;
+			double step = m_header->quantizationStep;
+			for (int i = 0; i < n; i++)
+			{
+				positions[i] = glm::vec3((float)(m_quantized[i * 3] * step), (float)(m_quantized[i * 3 + 1] * step), (float)(m_quantized[i * 3 + 2] * step));
+			}
+
+			DecodeNormals(m_normals.data(), normals);
+			return true;
+		}
+
+		bool DecodeDelta(int frame, int keyframe)
+		{
+			const auto& entry = m_index[frame];
+			auto record = Record(entry);
+			if (!record)
+			{
+				m_decodedFrame = -1;
+				return false;
+			}
+
+			int count = m_header->numParticles * 3;
+			int normalCount = hasNormals() ? m_header->numParticles * 2 : 0;
+			if (frame == keyframe)
+			{
+				m_quantized.resize(count);
+				m_previous.assign(count, 0);
+				memcpy(m_quantized.data(), record, count * sizeof(int32_t));
+				m_normals.resize(normalCount);
+				memcpy(m_normals.data(), record + count * sizeof(int32_t), normalCount * sizeof(int16_t));
+			}
+			else
+			{
+				const uint8_t* in = record;
+				const uint8_t* end = record + entry.size;
+				m_residuals.resize(max(count, normalCount));
+				if (!VtCacheCodec::GetBlocks(in, end, m_residuals.data(), count))
+				{
+					m_decodedFrame = -1;
+					return false;
+				}
+
+				bool linear = frame - keyframe >= 2;
+				for (int i = 0; i < count; i++)
+				{
+					int64_t prediction = linear ? 2 * (int64_t)m_quantized[i] - m_previous[i] : m_quantized[i];
+					m_previous[i] = m_quantized[i];
+					m_quantized[i] = (int32_t)(prediction + m_residuals[i]);
+				}
+
+				if (!VtCacheCodec::GetBlocks(in, end, m_residuals.data(), normalCount))
+				{
+					m_decodedFrame = -1;
+					return false;
+				}
+				for (int i = 0; i < normalCount; i++)
+				{
+					m_normals[i] = (int16_t)(m_normals[i] + m_residuals[i]);
+				}
+			}
+			m_decodedFrame = frame;
+			return true;
+		}
+
+		size_t normalSize() const
+		{
+			return hasNormals() ? m_header->numParticles * 2 * sizeof(int16_t) : 0;
+		}
+	};
+}
\ No newline at end of file
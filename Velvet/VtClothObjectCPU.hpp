@@ -4,6 +4,9 @@
 #include "VtClothSolverCPU.hpp"
 #include "MeshRenderer.hpp"
 #include "MouseGrabber.hpp"
+#include "Collider.hpp"
+#include "GameInstance.hpp"
+#include "VtClothCache.hpp"
 
 namespace VRThreads
 {
@@ -19,14 +22,22 @@ namespace VRThreads
 
 		void SetAttachedIndices(vector<int> indices)
 		{
-			m_solver->SetAttachedIndices(indices);
+			m_solver->SetAttachedIndices(move(indices));
 		}
 
 		void Start() override
 		{
-			auto mesh = actor->GetComponent<MeshRenderer>()->mesh();
-			m_solver->Initialize(mesh, actor->transform->matrix());
+			m_mesh = actor->GetComponent<MeshRenderer>()->mesh();
+			auto positions = m_mesh->vertices();
+			auto modelMatrix = actor->transform->matrix();
+			for (auto& position : positions)
+			{
+				position = modelMatrix * glm::vec4(position, 1.0f);
+			}
+			m_solver->Initialize(move(positions), m_mesh->indices());
 			actor->transform->Reset();
+
+			m_colliders = Global::game->FindComponents<Collider>();
 		}
 
 		void Update() override
@@ -37,7 +48,10 @@ namespace VRThreads
 		void FixedUpdate() override
 		{
 			UpdateGrappedVertex();
+			UpdateColliders();
 			m_solver->Simulate();
+			m_mesh->SetVerticesAndNormals(m_solver->m_positions, m_solver->m_normals);
+			UpdateBake();
 		}
 
 		shared_ptr<VtClothSolverCPU> solver() const
@@ -47,11 +61,29 @@ namespace VRThreads
 
 	private:
 		shared_ptr<VtClothSolverCPU> m_solver;
+		shared_ptr<Mesh> m_mesh;
+		vector<Collider*> m_colliders;
+		vector<SDFCollider> m_sdfColliders;
+		VtClothCacheWriter m_cacheWriter;
 
 		bool m_isGrabbing = false;
 		float m_grabbedVertexMass = 0;
 		RaycastCollision m_rayCollision;
 
+		void UpdateBake()
+		{
+			if (Global::gameState.bakeCache && !m_cacheWriter.isOpen())
+			{
+				string path = fmt::format("velvet_bake_{}.vtc", actor->name);
+				m_cacheWriter.Open(path, m_mesh->indices(), (int)m_solver->m_positions.size(), 1.0f / Timer::fixedDeltaTime());
+			}
+			else if (!Global::gameState.bakeCache && m_cacheWriter.isOpen())
+			{
+				m_cacheWriter.Close();
+			}
+			m_cacheWriter.WriteFrame(m_solver->m_positions, m_solver->m_normals);
+		}
+
 		void HandleMouseInteraction()
 		{
 			bool shouldPickObject = Global::input->GetMouseDown(GLFW_MOUSE_BUTTON_LEFT);
@@ -95,6 +127,19 @@ namespace VRThreads
 			return RaycastCollision{ minDistanceToRay < 0.2, result, distanceToView };
 		}
 
+		void UpdateColliders()
+		{
+			m_sdfColliders.clear();
+			for (auto c : m_colliders)
+			{
+				if (c->enabled)
+				{
+					m_sdfColliders.push_back(c->GetSDFCollider());
+				}
+			}
+			m_solver->SetColliders(m_sdfColliders);
+		}
+
 		void UpdateGrappedVertex()
 		{
 			if (m_isGrabbing)
@@ -21,7 +21,7 @@ namespace VRThreads
 
 		void SetAttachedIndices(vector<int> indices)
 		{
-			m_attachedIndices = indices;
+			m_attachedIndices = move(indices);
 		}
 
 		auto particleDiameter() const
@@ -45,7 +45,7 @@ namespace VRThreads
 			auto mesh = actor->GetComponent<MeshRenderer>()->mesh();
 			auto transformMatrix = actor->transform->matrix();
 			auto positions = mesh->vertices();
-			auto indices = mesh->indices();
+			const auto& indices = mesh->indices();
 			m_particleDiameter = glm::length(positions[0] - positions[1]) * Global::simParams.particleDiameterScalar;
 
 			m_indexOffset = m_solver->AddCloth(mesh, transformMatrix, m_particleDiameter);
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include <fmt/format.h>
+
+#include "Component.hpp"
+#include "Actor.hpp"
+#include "MeshRenderer.hpp"
+#include "Timer.hpp"
+#include "Global.hpp"
+#include "GUI.hpp"
+#include "VtClothCache.hpp"
+#include "VtNormals.hpp"
+
+namespace VRThreads
+{
+	/// <summary>
+	/// Plays a baked cloth cache (see VtClothCache.hpp) on the mesh of the actor without running a solver.
+	/// The cache is memory mapped, Raw frames are uploaded straight from the mapping, other encodings are decoded first.
+	/// firstParticle selects the cloth inside a cache baked from several cloths.
+	/// </summary>
+	class VtClothPlayback : public Component
+	{
+	public:
+		VtClothPlayback(const string& path, int firstParticle = 0, bool loop = true)
+		{
+			SET_COMPONENT_NAME;
+
+			m_path = path;
+			m_firstParticle = firstParticle;
+			m_loop = loop;
+		}
+
+		void Start() override
+		{
+			m_mesh = actor->GetComponent<MeshRenderer>()->mesh();
+			if (!m_reader.Open(m_path)) return;
+
+			int numVertices = (int)m_mesh->vertices().size();
+			if (m_firstParticle + numVertices > m_reader.numParticles())
+			{
+				fmt::print("Error(ClothPlayback): [{}] has {} particles, mesh needs {} from particle {}.\n", m_path,
+					m_reader.numParticles(), numVertices, m_firstParticle);
+				m_reader.Close();
+				return;
+			}
+
+			// the hash covers every cloth of the cache, so only whole-cache playback can be checked
+			const auto& indices = m_mesh->indices();
+			if (m_firstParticle == 0 && numVertices == m_reader.numParticles() &&
+				VtCacheCodec::TopologyHash(numVertices, indices.data(), indices.size()) != m_reader.topologyHash())
+			{
+				fmt::print("Warning(ClothPlayback): [{}] was baked from a different mesh.\n", m_path);
+			}
+
+			if (!m_reader.hasNormals())
+			{
+				m_vertexNormals.Initialize(indices, numVertices);
+				m_normals.resize(numVertices);
+			}
+
+			// cache positions are in world space
+			actor->transform->Reset();
+			fmt::print("Info(ClothPlayback): [{}] {} frames at {:.1f} fps\n", m_path, m_reader.numFrames(), m_reader.frameRate());
+			ShowGUI();
+			ShowFrame(0);
+		}
+
+		void Update() override
+		{
+			if (!m_reader.isOpen() || !m_playing || Global::gameState.pause) return;
+
+			m_time += Timer::deltaTime();
+			float duration = numFrames() / m_reader.frameRate();
+			if (m_time >= duration)
+			{
+				m_time = m_loop ? fmod(m_time, duration) : duration;
+			}
+			ShowFrame(min((int)(m_time * m_reader.frameRate()), numFrames() - 1));
+		}
+
+		// Random access for scrubbing, frames are clamped to the cache
+		void SetFrame(int frame)
+		{
+			if (!m_reader.isOpen()) return;
+			frame = glm::clamp(frame, 0, numFrames() - 1);
+			m_time = frame / m_reader.frameRate();
+			ShowFrame(frame);
+		}
+
+		void SetPlaying(bool playing)
+		{
+			m_playing = playing;
+		}
+
+		int frame() const
+		{
+			return m_frame;
+		}
+
+		int numFrames() const
+		{
+			return m_reader.numFrames();
+		}
+
+	private:
+		string m_path;
+		int m_firstParticle = 0;
+		bool m_loop = true;
+		bool m_playing = true;
+		float m_time = 0;
+		int m_frame = -1;
+
+		shared_ptr<Mesh> m_mesh;
+		VtClothCacheReader m_reader;
+		vector<glm::vec3> m_positions;
+		vector<glm::vec3> m_normals;
+		VtNormals m_vertexNormals; // for caches baked without normals
+
+		void ShowFrame(int frame)
+		{
+			if (frame == m_frame || frame < 0) return;
+
+			int count = (int)m_mesh->vertices().size();
+			auto positions = m_reader.RawPositions(frame);
+			auto normals = m_reader.RawNormals(frame);
+			if (!positions)
+			{
+				if (!m_reader.ReadFrame(frame, m_positions, &m_normals)) return;
+				positions = m_positions.data();
+				normals = m_reader.hasNormals() ? m_normals.data() : nullptr;
+			}
+
+			positions += m_firstParticle;
+			if (normals)
+			{
+				normals += m_firstParticle;
+			}
+			else
+			{
+				m_vertexNormals.Compute(positions, m_normals.data());
+				normals = m_normals.data();
+			}
+			m_mesh->SetVerticesAndNormals(positions, normals, count);
+			m_frame = frame;
+		}
+
+		void ShowGUI()
+		{
+			GUI::RegisterDebug([this]() {
+				ImGui::Checkbox("Play Cache", &m_playing);
+				int frame = m_frame;
+				if (IMGUI_LEFT_LABEL(ImGui::SliderInt, "CacheFrame", &frame, 0, numFrames() - 1))
+				{
+					SetFrame(frame);
+				}
+			});
+		}
+	};
+}
\ No newline at end of file
@@ -1,16 +1,19 @@
 #pragma once
 
-#include "Actor.hpp"
-#include "Component.hpp"
-#include "MeshRenderer.hpp"
+#include <vector>
+#include <memory>
+#include <tuple>
+
+#include <fmt/format.h>
+#include <glm/glm.hpp>
+
 #include "Global.hpp"
-#include "GameInstance.hpp"
-#include "Collider.hpp"
-#include "Camera.hpp"
-#include "Input.hpp"
-#include "GUI.hpp"
 #include "SpatialHashCPU.hpp"
 #include "Timer.hpp"
+#include "VtThreadPool.hpp"
+#include "VtConstraintsCPU.hpp"
+#include "VtSimdCPU.hpp"
+#include "VtNormals.hpp"
 
 namespace VRThreads
 {
@@ -22,10 +25,11 @@ namespace VRThreads
 		vector<glm::vec3> m_predicted;
 		vector<glm::vec3> m_velocities;
 		vector<float> m_inverseMass;
+		vector<glm::vec3> m_normals; // vertex normals of m_positions, updated at the end of Simulate()
 
-		vector<tuple<int, int, float>> m_stretchConstraints; // idx1, idx2, distance
+		VtConstraintsCPU<2> m_stretchConstraints; // idx1, idx2, distance
 		vector<tuple<int, glm::vec3>> m_attachmentConstriants; // idx1, position
-		vector<tuple<int, int, int, int, float>> m_bendingConstraints; // idx1, idx2, idx3, idx4, angle
+		VtConstraintsCPU<4> m_bendingConstraints; // idx1, idx2, idx3, idx4, angle
 		vector<tuple<int, int, int, int>> m_selfCollisionConstraints; // idx1, triangle(idx2, idx3, idx4)
 		// SimBuffer End
 
@@ -36,67 +40,113 @@ namespace VRThreads
 
 		void SetAttachedIndices(vector<int> indices)
 		{
-			m_attachedIndices = indices;
+			m_attachedIndices = move(indices);
+		}
+
+		// Solvers of one simulation should share a pool, otherwise idle workers of one solver spin while the next one runs.
+		// The owner of a shared pool sizes it, numCpuThreads is only applied to the pool the solver creates itself.
+		void SetThreadPool(shared_ptr<VtThreadPool> threadPool)
+		{
+			m_threadPool = threadPool;
+			m_sharedThreadPool = threadPool != nullptr;
 		}
 
-		void Initialize(shared_ptr<Mesh> mesh, glm::mat4 modelMatrix)
+		// positions are in world space and taken over by the solver. It doesn't depend on the renderer, so it also runs headless.
+		void Initialize(vector<glm::vec3> positions, const vector<unsigned int>& indices)
 		{
 			fmt::print("Info(VtClothSolver): Start\n");
-			m_mesh = mesh;
 
-			m_positions = m_mesh->vertices();
+			m_positions = move(positions);
 			m_numVertices = (int)m_positions.size();
-			for (int i = 0; i < m_numVertices; i++)
-			{
-				m_positions[i] = modelMatrix * glm::vec4(m_positions[i], 1.0f);
-			}
-
-			m_indices = m_mesh->indices();
-			m_colliders = Global::game->FindComponents<Collider>();
+			m_indices = indices;
+			m_vertexNormals.Initialize(m_indices, m_numVertices);
+			m_normalPositions.clear();
 
 			m_velocities = vector<glm::vec3>(m_numVertices);
 			m_predicted = vector<glm::vec3>(m_numVertices);
 			m_inverseMass = vector<float>(m_numVertices, 1.0);
 
 			m_particleDiameter = glm::length(m_positions[0] - m_positions[m_resolution + 1]);
-			m_spatialHash = make_shared<SpatialHashCPU>(m_particleDiameter, m_numVertices);
+			// neighbors are cached within the hash cell size, the extra distance is the skin of the cache
+			float hashCellSize = m_particleDiameter * max(1.0f, Global::simParams.hashCellSizeScalar);
+			m_hashSkin = hashCellSize - m_particleDiameter;
+			m_spatialHash = make_shared<SpatialHashCPU>(hashCellSize, m_numVertices);
+			UpdateThreadPool();
+
+			m_simdLevel = VtSimdCPU::DetectLevel();
+			m_stretchKernel = VtSimdCPU::SelectStretchKernel(m_simdLevel);
 
 			GenerateStretch();
 			GenerateAttachment(m_attachedIndices);
 			GenerateBending();
+
+			m_stretchConstraints.Build(m_numVertices);
+			m_bendingConstraints.Build(m_numVertices);
+			GenerateDeltaSlots();
+
+			m_contactOffsets = vector<int>(m_numVertices + 1, 0);
+			m_particleDeltas = vector<glm::vec4>(m_numVertices);
+			fmt::print("Info(VtClothSolver): {} threads, {} stretch colors, {} bending colors, {} stretch kernel\n", m_threadPool->numThreads(),
+				m_stretchConstraints.numColors(), m_bendingConstraints.numColors(), VtSimdCPU::LevelName(m_simdLevel));
 		}
 
 		void Simulate()
 		{
+			ScopedTimer timer(TIMER_ID("Solver_Total"));
+			UpdateThreadPool();
+
 			float frameTime = Timer::fixedDeltaTime();
-			float substepTime = Timer::fixedDeltaTime() / Global::simParams.numSubsteps;
+			float substepTime = frameTime / Global::simParams.numSubsteps;
 
 			// Pre-stablization pass [Unified particle physics for real-time applications (4.4)]
-			CollideSDF(m_positions);
-
-			PredictPositions(frameTime);
-			m_spatialHash->HashObjects(m_predicted);
+			CollideSDF(m_positions, frameTime);
 
 			for (int substep = 0; substep < Global::simParams.numSubsteps; substep++)
 			{
 				PredictPositions(substepTime);
+
+				if (Global::simParams.enableSelfCollision)
+				{
+					UpdateNeighborCache();
+				}
+				else
+				{
+					m_hashPositions.clear();
+				}
 				//GenerateSelfCollision();
 				for (int iteration = 0; iteration < Global::simParams.numIterations; iteration++)
 				{
-					SolveStretch(substepTime);
-					SolveBending(substepTime);
+					if (Global::simParams.enableJacobiCPU)
+					{
+						SolveStretchJacobi();
+						SolveBendingJacobi(substepTime);
+						ApplyDeltas();
+					}
+					else
+					{
+						SolveStretch(substepTime);
+						SolveBending(substepTime);
+					}
 
 					//SolveSelfCollision();
-					CollideParticles();
-					CollideSDF(m_predicted);
+					if (Global::simParams.enableSelfCollision)
+					{
+						CollideParticles();
+					}
+					CollideSDF(m_predicted, substepTime);
 
 					SolveAttachment();
 				}
 				Finalize(substepTime);
 			}
 
-			auto normals = ComputeNormals(m_positions);
-			m_mesh->SetVerticesAndNormals(m_positions, normals);
+			ComputeNormals();
+		}
+
+		// Colliders at the current frame, usually updated before each Simulate()
+		void SetColliders(const vector<SDFCollider>& colliders)
+		{
+			m_colliders = colliders;
 		}
 
 		float particleDiameter() const
@@ -104,6 +154,11 @@ namespace VRThreads
 			return m_particleDiameter;
 		}
 
+		int numThreads() const
+		{
+			return m_threadPool->numThreads();
+		}
+
 	private: // Generate constraints
 
 		void GenerateStretch()
@@ -126,31 +181,31 @@ namespace VRThreads
 					{
 						idx1 = VertexAt(x, y);
 						idx2 = VertexAt(x, y + 1);
-						m_stretchConstraints.push_back(make_tuple(idx1, idx2, DistanceBetween(idx1, idx2)));
+						m_stretchConstraints.Add({ idx1, idx2 }, DistanceBetween(idx1, idx2));
 					}
 
 					if (x != m_resolution)
 					{
 						idx1 = VertexAt(x, y);
 						idx2 = VertexAt(x + 1, y);
-						m_stretchConstraints.push_back(make_tuple(idx1, idx2, DistanceBetween(idx1, idx2)));
+						m_stretchConstraints.Add({ idx1, idx2 }, DistanceBetween(idx1, idx2));
 					}
 
 					if (y != m_resolution && x != m_resolution)
 					{
 						idx1 = VertexAt(x, y);
 						idx2 = VertexAt(x + 1, y + 1);
-						m_stretchConstraints.push_back(make_tuple(idx1, idx2, DistanceBetween(idx1, idx2)));
+						m_stretchConstraints.Add({ idx1, idx2 }, DistanceBetween(idx1, idx2));
 
 						idx1 = VertexAt(x, y + 1);
 						idx2 = VertexAt(x + 1, y);
-						m_stretchConstraints.push_back(make_tuple(idx1, idx2, DistanceBetween(idx1, idx2)));
+						m_stretchConstraints.Add({ idx1, idx2 }, DistanceBetween(idx1, idx2));
 					}
 				}
 			}
 		}
 
-		void GenerateAttachment(vector<int> indices)
+		void GenerateAttachment(const vector<int>& indices)
 		{
 			for (auto i : indices)
 			{
@@ -171,7 +226,7 @@ namespace VRThreads
 
 				// calculate angle
 				float angle = 0;
-				m_bendingConstraints.push_back(make_tuple(idx1, idx2, idx3, idx4, angle));
+				m_bendingConstraints.Add({ idx1, idx2, idx3, idx4 }, angle);
 			}
 		}
 
@@ -180,117 +235,357 @@ namespace VRThreads
 
 		}
 
-	private: // Core physics
+		// Verlet-list style neighbor cache: pairs are gathered within particleDiameter + skin, so the cache stays valid
+		// until a particle has moved more than half the skin since the last build. The displacement is checked every
+		// substep, interleavedHash only bounds the age of the cache (it is rebuilt at least once every interleavedHash substeps).
+		void UpdateNeighborCache()
+		{
+			ScopedTimer timer(TIMER_ID("Solver_HashCache"));
+			m_hashAge++;
+			if (!m_hashPositions.empty() && m_hashAge < max(1, Global::simParams.interleavedHash) &&
+				MaxDisplacement(m_predicted, m_hashPositions) <= 0.5f * m_hashSkin)
+			{
+				return;
+			}
 
-		void PredictPositions(float deltaTime)
+			m_spatialHash->HashObjects(m_predicted, *m_threadPool);
+			GenerateContacts();
+			m_hashPositions = m_predicted;
+			m_hashAge = 0;
+		}
+
+		float MaxDisplacement(const vector<glm::vec3>& positions, const vector<glm::vec3>& reference)
 		{
+			m_threadMaxima.assign(m_threadPool->numThreads(), 0.0f);
+			m_threadPool->ParallelFor(m_numVertices, [this, &positions, &reference](int begin, int end, int threadIndex) {
+				float maxDistance2 = m_threadMaxima[threadIndex];
+				for (int i = begin; i < end; i++)
+				{
+					glm::vec3 diff = positions[i] - reference[i];
+					maxDistance2 = max(maxDistance2, glm::dot(diff, diff));
+				}
+				m_threadMaxima[threadIndex] = maxDistance2;
+				}, k_particleGrainSize);
+			return sqrt(*max_element(m_threadMaxima.begin(), m_threadMaxima.end()));
+		}
+
+		// Unique contact pairs (i < j) from the symmetric neighbor list, colored so that they can be solved in parallel
+		void GenerateContacts()
+		{
+			m_threadPool->ParallelFor(m_numVertices, [this](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					int count = 0;
+					for (int j : m_spatialHash->GetNeighbors(i))
+					{
+						if (i < j) count++;
+					}
+					m_contactOffsets[i + 1] = count;
+				}
+				}, k_particleGrainSize);
+
 			for (int i = 0; i < m_numVertices; i++)
 			{
-				m_velocities[i] += Global::simParams.gravity * deltaTime;
-				m_predicted[i] = m_positions[i] + m_velocities[i] * deltaTime;
+				m_contactOffsets[i + 1] += m_contactOffsets[i];
 			}
+			m_contacts.Resize(m_contactOffsets[m_numVertices]);
+
+			m_threadPool->ParallelFor(m_numVertices, [this](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					int k = m_contactOffsets[i];
+					for (int j : m_spatialHash->GetNeighbors(i))
+					{
+						if (i >= j) continue;
+						m_contacts.indices[0][k] = i;
+						m_contacts.indices[1][k] = j;
+						m_contacts.restValues[k] = m_particleDiameter;
+						k++;
+					}
+				}
+				}, k_particleGrainSize);
+
+			m_contacts.Build(m_numVertices);
 		}
 
-		void SolveStretch(float deltaTime)
+		// Jacobi mode: every constraint writes its corrections into private slots (stretch slots first, then bending),
+		// and each particle gathers its slots in a fixed order. The result doesn't depend on the number of threads.
+		void GenerateDeltaSlots()
 		{
-			for (auto c : m_stretchConstraints)
+			int numStretch = m_stretchConstraints.size();
+			int numBending = m_bendingConstraints.size();
+			m_constraintDeltas = vector<glm::vec4>(numStretch * 2 + numBending * 4);
+
+			auto ParticleOfSlot = [this, numStretch](int slot) {
+				if (slot < numStretch * 2) return m_stretchConstraints.indices[slot % 2][slot / 2];
+				slot -= numStretch * 2;
+				return m_bendingConstraints.indices[slot % 4][slot / 4];
+			};
+
+			m_deltaOffsets = vector<int>(m_numVertices + 1, 0);
+			for (int slot = 0; slot < m_constraintDeltas.size(); slot++)
 			{
-				auto idx1 = get<0>(c);
-				auto idx2 = get<1>(c);
-				auto expectedDistance = get<2>(c);
-
-				glm::vec3 diff = m_predicted[idx1] - m_predicted[idx2];
-				float distance = glm::length(diff);
-				auto w1 = m_inverseMass[idx1];
-				auto w2 = m_inverseMass[idx2];
-
-				// We use unilateral constraints instead of bilateral constraints
-				// Otherwise the cloth may not look well after collision
-				if (distance > expectedDistance && w1 + w2 > 0)
+				m_deltaOffsets[ParticleOfSlot(slot) + 1]++;
+			}
+			for (int i = 0; i < m_numVertices; i++)
+			{
+				m_deltaOffsets[i + 1] += m_deltaOffsets[i];
+			}
+
+			vector<int> cursor(m_deltaOffsets.begin(), m_deltaOffsets.end() - 1);
+			m_deltaSlots = vector<int>(m_constraintDeltas.size());
+			for (int slot = 0; slot < m_constraintDeltas.size(); slot++)
+			{
+				m_deltaSlots[cursor[ParticleOfSlot(slot)]++] = slot;
+			}
+		}
+
+	private: // Core physics
+
+		void PredictPositions(float deltaTime)
+		{
+			ScopedTimer timer(TIMER_ID("Solver_Predict"));
+			m_threadPool->ParallelFor(m_numVertices, [this, deltaTime](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
 				{
-					auto gradient = diff / (distance + k_epsilon);
-					// compliance is zero, therefore XPBD=PBD
-					auto denom = w1 + w2;
-					auto lambda = (distance - expectedDistance) / denom;
-					m_predicted[idx1] -= w1 * lambda * gradient;
-					m_predicted[idx2] += w2 * lambda * gradient;
+					m_velocities[i] += Global::simParams.gravity * deltaTime;
+					m_predicted[i] = m_positions[i] + m_velocities[i] * deltaTime;
 				}
+				}, k_particleGrainSize);
+		}
+
+		void SolveStretch(float deltaTime)
+		{
+			ScopedTimer timer(TIMER_ID("Solver_SolveStretch"));
+			const auto& offsets = m_stretchConstraints.colorOffsets;
+			for (int color = 0; color < m_stretchConstraints.numColors(); color++)
+			{
+				int first = offsets[color];
+				int count = offsets[color + 1] - first;
+				m_threadPool->ParallelFor(count, [this, first](int begin, int end, int) {
+					int i = first + begin;
+					if (m_stretchKernel != nullptr)
+					{
+						// vectorized batches of 8/16 constraints, the remainder falls through to the scalar path
+						i = m_stretchKernel(reinterpret_cast<float*>(m_predicted.data()), m_inverseMass.data(),
+							m_stretchConstraints.indices[0].data(), m_stretchConstraints.indices[1].data(),
+							m_stretchConstraints.restValues.data(), i, first + end);
+					}
+					for (; i < first + end; i++)
+					{
+						SolveStretchConstraint(i);
+					}
+					}, k_constraintGrainSize);
+			}
+		}
+
+		void SolveStretchConstraint(int i)
+		{
+			auto idx1 = m_stretchConstraints.indices[0][i];
+			auto idx2 = m_stretchConstraints.indices[1][i];
+			auto expectedDistance = m_stretchConstraints.restValues[i];
+
+			glm::vec3 diff = m_predicted[idx1] - m_predicted[idx2];
+			float distance = glm::length(diff);
+			auto w1 = m_inverseMass[idx1];
+			auto w2 = m_inverseMass[idx2];
+
+			// We use unilateral constraints instead of bilateral constraints
+			// Otherwise the cloth may not look well after collision
+			if (distance > expectedDistance && w1 + w2 > 0)
+			{
+				auto gradient = diff / (distance + k_epsilon);
+				// compliance is zero, therefore XPBD=PBD
+				auto denom = w1 + w2;
+				auto lambda = (distance - expectedDistance) / denom;
+				m_predicted[idx1] -= w1 * lambda * gradient;
+				m_predicted[idx2] += w2 * lambda * gradient;
 			}
 		}
 
 		void SolveBending(float deltaTime)
 		{
+			ScopedTimer timer(TIMER_ID("Solver_SolveBending"));
 			float xpbd_bend = Global::simParams.bendCompliance / deltaTime / deltaTime;
-			for (auto c : m_bendingConstraints)
+			const auto& offsets = m_bendingConstraints.colorOffsets;
+			for (int color = 0; color < m_bendingConstraints.numColors(); color++)
 			{
-				// tri(idx1, idx3, idx2) and tri(idx1, idx2, idx4)
-				auto idx1 = get<2>(c);
-				auto idx2 = get<1>(c);
-				auto idx3 = get<0>(c);
-				auto idx4 = get<3>(c);
-				auto expectedAngle = get<4>(c);
-
-				auto w1 = m_inverseMass[idx1];
-				auto w2 = m_inverseMass[idx2];
-				auto w3 = m_inverseMass[idx3];
-				auto w4 = m_inverseMass[idx4];
-
-				auto p1 = m_predicted[idx1];
-				auto p2 = m_predicted[idx2] - p1;
-				auto p3 = m_predicted[idx3] - p1;
-				auto p4 = m_predicted[idx4] - p1;
-
-				glm::vec3 n1 = glm::normalize(glm::cross(p2, p3));
-				glm::vec3 n2 = glm::normalize(glm::cross(p2, p4));
-
-				float d = clamp(glm::dot(n1, n2), 0.0f, 1.0f);
-				float angle = acos(d);
-				// cross product for two equal vector produces NAN
-				if (angle < k_epsilon || isnan(d)) continue;
-
-				glm::vec3 q3 = (glm::cross(p2, n2) + glm::cross(n1, p2) * d) / (glm::length(glm::cross(p2, p3)) + k_epsilon);
-				glm::vec3 q4 = (glm::cross(p2, n1) + glm::cross(n2, p2) * d) / (glm::length(glm::cross(p2, p4)) + k_epsilon);
-				glm::vec3 q2 = -(glm::cross(p3, n2) + glm::cross(n1, p3) * d) / (glm::length(glm::cross(p2, p3)) + k_epsilon)
-					- (glm::cross(p4, n1) + glm::cross(n2, p4) * d) / (glm::length(glm::cross(p2, p4)) + k_epsilon);
-				glm::vec3 q1 = -q2 - q3 - q4;
-
-				float denom = xpbd_bend + (w1 * glm::dot(q1, q1) + w2 * glm::dot(q2, q2) + w3 * glm::dot(q3, q3) + w4 * glm::dot(q4, q4));
-				if (denom < k_epsilon) continue; // ?
-				float lambda = sqrt(1.0f - d * d) * (angle - expectedAngle) / denom;
-
-				//if (isnan(lambda) || glm::all(glm::isnan(q1)) || glm::all(glm::isnan(q2)) || glm::all(glm::isnan(q3)) || glm::all(glm::isnan(q4)))
-				//{
-				//	fmt::print("NAN detected\n");
-				//}
-
-				m_predicted[idx1] += w1 * lambda * q1;
-				m_predicted[idx2] += w2 * lambda * q2;
-				m_predicted[idx3] += w3 * lambda * q3;
-				m_predicted[idx4] += w4 * lambda * q4;
-
+				int first = offsets[color];
+				int count = offsets[color + 1] - first;
+				m_threadPool->ParallelFor(count, [this, first, xpbd_bend](int begin, int end, int) {
+					for (int i = first + begin; i < first + end; i++)
+					{
+						SolveBendingConstraint(i, xpbd_bend);
+					}
+					}, k_constraintGrainSize);
 			}
 		}
 
-		void CollideSDF(vector<glm::vec3>& positions) const
+		void SolveBendingConstraint(int i, float xpbd_bend)
 		{
-			// SDF collision
-			for (int i = 0; i < m_numVertices; i++)
+			glm::vec3 corrections[4];
+			if (!ComputeBendingCorrections(i, xpbd_bend, corrections)) return;
+
+			for (int k = 0; k < 4; k++)
 			{
-				for (auto col : m_colliders)
+				m_predicted[m_bendingConstraints.indices[k][i]] += corrections[k];
+			}
+		}
+
+		// corrections[k] belongs to particle indices[k][i]. Returns false if the constraint is already satisfied.
+		bool ComputeBendingCorrections(int i, float xpbd_bend, glm::vec3 corrections[4]) const
+		{
+			// tri(idx1, idx3, idx2) and tri(idx1, idx2, idx4)
+			auto idx1 = m_bendingConstraints.indices[2][i];
+			auto idx2 = m_bendingConstraints.indices[1][i];
+			auto idx3 = m_bendingConstraints.indices[0][i];
+			auto idx4 = m_bendingConstraints.indices[3][i];
+			auto expectedAngle = m_bendingConstraints.restValues[i];
+
+			auto w1 = m_inverseMass[idx1];
+			auto w2 = m_inverseMass[idx2];
+			auto w3 = m_inverseMass[idx3];
+			auto w4 = m_inverseMass[idx4];
+
+			auto p1 = m_predicted[idx1];
+			auto p2 = m_predicted[idx2] - p1;
+			auto p3 = m_predicted[idx3] - p1;
+			auto p4 = m_predicted[idx4] - p1;
+
+			glm::vec3 n1 = glm::normalize(glm::cross(p2, p3));
+			glm::vec3 n2 = glm::normalize(glm::cross(p2, p4));
+
+			float d = clamp(glm::dot(n1, n2), 0.0f, 1.0f);
+			float angle = acos(d);
+			// cross product for two equal vector produces NAN
+			if (angle < k_epsilon || isnan(d)) return false;
+
+			glm::vec3 q3 = (glm::cross(p2, n2) + glm::cross(n1, p2) * d) / (glm::length(glm::cross(p2, p3)) + k_epsilon);
+			glm::vec3 q4 = (glm::cross(p2, n1) + glm::cross(n2, p2) * d) / (glm::length(glm::cross(p2, p4)) + k_epsilon);
+			glm::vec3 q2 = -(glm::cross(p3, n2) + glm::cross(n1, p3) * d) / (glm::length(glm::cross(p2, p3)) + k_epsilon)
+				- (glm::cross(p4, n1) + glm::cross(n2, p4) * d) / (glm::length(glm::cross(p2, p4)) + k_epsilon);
+			glm::vec3 q1 = -q2 - q3 - q4;
+
+			float denom = xpbd_bend + (w1 * glm::dot(q1, q1) + w2 * glm::dot(q2, q2) + w3 * glm::dot(q3, q3) + w4 * glm::dot(q4, q4));
+			if (denom < k_epsilon) return false; // ?
+			float lambda = sqrt(1.0f - d * d) * (angle - expectedAngle) / denom;
+
+			//if (isnan(lambda) || glm::all(glm::isnan(q1)) || glm::all(glm::isnan(q2)) || glm::all(glm::isnan(q3)) || glm::all(glm::isnan(q4)))
+			//{
+			//	fmt::print("NAN detected\n");
+			//}
+
+			corrections[2] = w1 * lambda * q1;
+			corrections[1] = w2 * lambda * q2;
+			corrections[0] = w3 * lambda * q3;
+			corrections[3] = w4 * lambda * q4;
+			return true;
+		}
+
+		// Mirrors SolveStretch_Kernel: bilateral constraints, corrections are accumulated instead of applied
+		void SolveStretchJacobi()
+		{
+			ScopedTimer timer(TIMER_ID("Solver_SolveStretch"));
+			m_threadPool->ParallelFor(m_stretchConstraints.size(), [this](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
 				{
-					auto pos = positions[i];
-					glm::vec3 correction = col->ComputeSDF(pos);
-					positions[i] += correction;
+					auto idx1 = m_stretchConstraints.indices[0][i];
+					auto idx2 = m_stretchConstraints.indices[1][i];
+					auto expectedDistance = m_stretchConstraints.restValues[i];
+
+					glm::vec3 diff = m_predicted[idx1] - m_predicted[idx2];
+					float distance = glm::length(diff);
+					auto w1 = m_inverseMass[idx1];
+					auto w2 = m_inverseMass[idx2];
 
-					glm::vec3 relativeVelocity = positions[i] - m_positions[i];
-					auto friction = ComputeFriction(correction, relativeVelocity);
-					positions[i] += friction;
+					glm::vec4 correction1(0), correction2(0);
+					if (distance != expectedDistance && w1 + w2 > 0)
+					{
+						auto gradient = diff / (distance + k_epsilon);
+						// compliance is zero, therefore XPBD=PBD
+						auto denom = w1 + w2;
+						auto lambda = (distance - expectedDistance) / denom;
+						glm::vec3 common = lambda * gradient;
+						correction1 = glm::vec4(-w1 * common, 1);
+						correction2 = glm::vec4(w2 * common, 1);
+					}
+					m_constraintDeltas[i * 2] = correction1;
+					m_constraintDeltas[i * 2 + 1] = correction2;
 				}
-			}
+				}, k_constraintGrainSize);
+		}
+
+		void SolveBendingJacobi(float deltaTime)
+		{
+			ScopedTimer timer(TIMER_ID("Solver_SolveBending"));
+			float xpbd_bend = Global::simParams.bendCompliance / deltaTime / deltaTime;
+			glm::vec4* bendingDeltas = m_constraintDeltas.data() + m_stretchConstraints.size() * 2;
+
+			m_threadPool->ParallelFor(m_bendingConstraints.size(), [this, xpbd_bend, bendingDeltas](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					glm::vec3 corrections[4];
+					bool active = ComputeBendingCorrections(i, xpbd_bend, corrections);
+					for (int k = 0; k < 4; k++)
+					{
+						bendingDeltas[i * 4 + k] = active ? glm::vec4(corrections[k], 1) : glm::vec4(0);
+					}
+				}
+				}, k_constraintGrainSize);
+		}
+
+		// Mirrors ApplyDeltas_Kernel, w of each slot counts the constraints that moved the particle
+		void ApplyDeltas()
+		{
+			ScopedTimer timer(TIMER_ID("Solver_ApplyDeltas"));
+			m_threadPool->ParallelFor(m_numVertices, [this](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					glm::vec3 delta(0);
+					float count = 0;
+					for (int k = m_deltaOffsets[i]; k < m_deltaOffsets[i + 1]; k++)
+					{
+						const auto& slot = m_constraintDeltas[m_deltaSlots[k]];
+						delta += glm::vec3(slot);
+						count += slot.w;
+					}
+					if (count > 0)
+					{
+						m_predicted[i] += delta / count * Global::simParams.relaxationFactor;
+					}
+				}
+				}, k_particleGrainSize);
+		}
+
+		// Same as CollideSDF_Kernel, friction is relative to the velocity of the collider
+		void CollideSDF(vector<glm::vec3>& positions, float deltaTime) const
+		{
+			ScopedTimer timer(TIMER_ID("Solver_CollideSDFs"));
+			float collisionMargin = Global::simParams.collisionMargin;
+			m_threadPool->ParallelFor(m_numVertices, [this, &positions, deltaTime, collisionMargin](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					for (const auto& col : m_colliders)
+					{
+						auto pos = positions[i];
+						glm::vec3 velocity;
+						glm::vec3 correction = col.ComputeSDF(pos, collisionMargin, velocity);
+						positions[i] += correction;
+
+						if (glm::dot(correction, correction) > 0)
+						{
+							glm::vec3 relativeVelocity = positions[i] - m_positions[i] - velocity * deltaTime;
+							auto friction = ComputeFriction(correction, relativeVelocity);
+							positions[i] += friction;
+						}
+					}
+				}
+				}, k_particleGrainSize);
 		}
 
 		void SolveAttachment()
 		{
+			ScopedTimer timer(TIMER_ID("Solver_SolveAttach"));
 			for (const auto& c : m_attachmentConstriants)
 			{
 				int idx = get<0>(c);
@@ -315,53 +610,135 @@ namespace VRThreads
 
 		void CollideParticles()
 		{
-			for (int i = 0; i < m_numVertices; i++)
+			ScopedTimer timer(TIMER_ID("Solver_CollideParticles"));
+			if (Global::simParams.enableJacobiCPU)
+			{
+				CollideParticlesJacobi();
+				return;
+			}
+
+			const auto& offsets = m_contacts.colorOffsets;
+			for (int color = 0; color < m_contacts.numColors(); color++)
+			{
+				int first = offsets[color];
+				int count = offsets[color + 1] - first;
+				m_threadPool->ParallelFor(count, [this, first](int begin, int end, int) {
+					for (int i = first + begin; i < first + end; i++)
+					{
+						SolveContact(i);
+					}
+					}, k_constraintGrainSize);
+			}
+		}
+
+		void SolveContact(int i)
+		{
+			auto idx1 = m_contacts.indices[0][i];
+			auto idx2 = m_contacts.indices[1][i];
+			auto expectedDistance = m_contacts.restValues[i];
+
+			glm::vec3 diff = m_predicted[idx1] - m_predicted[idx2];
+			float distance = glm::length(diff);
+			auto w1 = m_inverseMass[idx1];
+			auto w2 = m_inverseMass[idx2];
+
+			if (distance < expectedDistance && w1 + w2 > 0)
 			{
-				const auto neighbors = m_spatialHash->GetNeighbors(i);
-				for (int j : neighbors)
+				auto gradient = diff / (distance + k_epsilon);
+				auto denom = w1 + w2;
+				auto lambda = (distance - expectedDistance) / denom;
+				auto common = lambda * gradient;
+				m_predicted[idx1] -= w1 * common;
+				m_predicted[idx2] += w2 * common;
+
+				glm::vec3 relativeVelocity = (m_predicted[idx1] - m_positions[idx1]) - (m_predicted[idx2] - m_positions[idx2]);
+				auto friction = ComputeFriction(common, relativeVelocity);
+				m_predicted[idx1] += w1 * friction;
+				m_predicted[idx2] -= w2 * friction;
+			}
+		}
+
+		// Mirrors CollideParticles_Kernel: each particle gathers the corrections from all of its neighbors
+		void CollideParticlesJacobi()
+		{
+			m_threadPool->ParallelFor(m_numVertices, [this](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
 				{
-					if (i >= j) continue;
-					auto idx1 = i;
-					auto idx2 = j;
-					auto expectedDistance = m_particleDiameter;
+					glm::vec3 positionDelta = glm::vec3(0);
+					int deltaCount = 0;
+					glm::vec3 pred_i = m_predicted[i];
+					glm::vec3 vel_i = (pred_i - m_positions[i]);
+					float w_i = m_inverseMass[i];
 
-					glm::vec3 diff = m_predicted[idx1] - m_predicted[idx2];
-					float distance = glm::length(diff);
-					auto w1 = m_inverseMass[idx1];
-					auto w2 = m_inverseMass[idx2];
+					for (int j : m_spatialHash->GetNeighbors(i))
+					{
+						float w_j = m_inverseMass[j];
+						float denom = w_i + w_j;
+						if (denom <= 0) continue;
+
+						glm::vec3 pred_j = m_predicted[j];
+						glm::vec3 diff = pred_i - pred_j;
+						float distance = glm::length(diff);
+						if (distance >= m_particleDiameter) continue;
+
+						glm::vec3 gradient = diff / (distance + k_epsilon);
+						float lambda = (distance - m_particleDiameter) / denom;
+						glm::vec3 common = lambda * gradient;
+
+						deltaCount++;
+						positionDelta -= w_i * common;
 
-					if (distance < expectedDistance && w1 + w2 > 0)
+						glm::vec3 relativeVelocity = vel_i - (pred_j - m_positions[j]);
+						glm::vec3 friction = ComputeFriction(common, relativeVelocity);
+						positionDelta += w_i * friction;
+					}
+					m_particleDeltas[i] = glm::vec4(positionDelta, (float)deltaCount);
+				}
+				}, k_particleGrainSize);
+
+			m_threadPool->ParallelFor(m_numVertices, [this](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					float count = m_particleDeltas[i].w;
+					if (count > 0)
 					{
-						auto gradient = diff / (distance + k_epsilon);
-						auto denom = w1 + w2;
-						auto lambda = (distance - expectedDistance) / denom;
-						auto common = lambda * gradient;
-						m_predicted[idx1] -= w1 * common;
-						m_predicted[idx2] += w2 * common;
-
-						glm::vec3 relativeVelocity = (m_predicted[idx1] - m_positions[idx1]) - (m_predicted[idx2] - m_positions[idx2]);
-						auto friction = ComputeFriction(common, relativeVelocity);
-						m_predicted[idx1] += w1 * friction;
-						m_predicted[idx2] -= w2 * friction;
+						m_predicted[i] += glm::vec3(m_particleDeltas[i]) / count * Global::simParams.relaxationFactor;
 					}
 				}
-			}
+				}, k_particleGrainSize);
 		}
 
 		void Finalize(float deltaTime)
 		{
+			ScopedTimer timer(TIMER_ID("Solver_Finalize"));
 			// apply force and update positions
-			for (int i = 0; i < m_numVertices; i++)
-			{
-				//m_velocities[i] = (m_predicted[i] - m_positions[i]) / deltaTime;
-				// damp
-				m_velocities[i] = (m_predicted[i] - m_positions[i]) / deltaTime * (1 - Global::simParams.damping * deltaTime);
-				m_positions[i] = m_predicted[i];
-			}
+			m_threadPool->ParallelFor(m_numVertices, [this, deltaTime](int begin, int end, int) {
+				for (int i = begin; i < end; i++)
+				{
+					//m_velocities[i] = (m_predicted[i] - m_positions[i]) / deltaTime;
+					// damp
+					m_velocities[i] = (m_predicted[i] - m_positions[i]) / deltaTime * (1 - Global::simParams.damping * deltaTime);
+					m_positions[i] = m_predicted[i];
+				}
+				}, k_particleGrainSize);
 		}
 
 	private: // Utility functions
 
+		// (Re)create the worker pool when numCpuThreads changes
+		void UpdateThreadPool()
+		{
+			if (m_sharedThreadPool) return;
+
+			int numThreads = Global::simParams.numCpuThreads;
+			if (numThreads <= 0) numThreads = max(1, (int)thread::hardware_concurrency());
+
+			if (m_threadPool == nullptr || m_threadPool->numThreads() != numThreads)
+			{
+				m_threadPool = make_shared<VtThreadPool>(numThreads);
+			}
+		}
+
 		glm::vec3 ComputeFriction(glm::vec3 correction, glm::vec3 relativeVelocity) const
 		{
 			glm::vec3 friction = glm::vec3(0);
@@ -379,32 +756,30 @@ namespace VRThreads
 			return friction;
 		}
 
-		vector<glm::vec3> ComputeNormals(const vector<glm::vec3> positions)
+		// Normals are kept while no particle moved further than normalUpdateDistance since they were computed,
+		// so a cloth at rest doesn't pay for them. The solver doesn't run at all while the game is paused.
+		void ComputeNormals()
 		{
-			vector<glm::vec3> normals(positions.size());
-			for (int i = 0; i < m_indices.size(); i += 3)
+			ScopedTimer timer(TIMER_ID("Solver_UpdateNormals"));
+			float updateDistance = Global::simParams.normalUpdateDistance;
+			if (updateDistance >= 0 && !m_normalPositions.empty() && MaxDisplacement(m_positions, m_normalPositions) <= updateDistance)
+			{
+				return;
+			}
+			m_vertexNormals.Compute(m_positions, m_normals, *m_threadPool);
+
+			// no snapshot when the normals are recomputed every frame anyway
+			if (updateDistance >= 0)
 			{
-				auto idx1 = m_indices[i];
-				auto idx2 = m_indices[i + 1];
-				auto idx3 = m_indices[i + 2];
-
-				auto p1 = positions[idx1];
-				auto p2 = positions[idx2];
-				auto p3 = positions[idx3];
-
-				auto normal = glm::cross(p2 - p1, p3 - p1);
-				normals[idx1] += normal;
-				normals[idx2] += normal;
-				normals[idx3] += normal;
+				m_normalPositions = m_positions;
 			}
-			for (int i = 0; i < normals.size(); i++)
+			else
 			{
-				normals[i] = glm::normalize(normals[i]);
+				m_normalPositions.clear();
 			}
-			return normals;
 		}
 
-		inline bool CheckNAN(const vector<glm::vec3> positions)
+		inline bool CheckNAN(const vector<glm::vec3>& positions)
 		{
 			for (int i = 0; i < positions.size(); i++)
 			{
@@ -420,16 +795,38 @@ namespace VRThreads
 	private:
 
 		const float k_epsilon = 1e-6f;
+		const int k_particleGrainSize = 1024;
+		const int k_constraintGrainSize = 512;
 
 		int m_numVertices;
 		int m_resolution;
 		float m_particleDiameter;
 
 		vector<unsigned int> m_indices;
-		vector<Collider*> m_colliders;
+		vector<SDFCollider> m_colliders;
 		vector<int> m_attachedIndices;
 
-		shared_ptr<Mesh> m_mesh;
+		vector<glm::vec4> m_constraintDeltas; // Jacobi mode: xyz correction, w is 1 if the constraint is active
+		vector<int> m_deltaOffsets; // slots of particle i are m_deltaSlots[offsets[i], offsets[i+1])
+		vector<int> m_deltaSlots;
+
+		float m_hashSkin = 0;
+		int m_hashAge = 0;			// substeps since the neighbor cache was built
+		vector<glm::vec3> m_hashPositions; // predicted positions at the last hash, empty if the cache is invalid
+		vector<float> m_threadMaxima;
+
+		VtNormals m_vertexNormals;
+		vector<glm::vec3> m_normalPositions; // positions at the last normal update, empty if the normals are invalid
+
+		VtConstraintsCPU<2> m_contacts; // self collision pairs, rebuilt after each hash
+		vector<int> m_contactOffsets; // contacts of particle i (as the lower index) start at offsets[i] before coloring
+		vector<glm::vec4> m_particleDeltas; // Jacobi mode: xyz correction, w number of contacts
+
 		shared_ptr<SpatialHashCPU> m_spatialHash;
+		shared_ptr<VtThreadPool> m_threadPool;
+		bool m_sharedThreadPool = false;
+
+		SimdLevel m_simdLevel = SimdLevel::Scalar;
+		StretchKernel m_stretchKernel = nullptr;
 	};
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "Common.hpp"
 #include "Timer.hpp"
 
+#include <thrust/inner_product.h>
+#include <thrust/functional.h>
+
 using namespace std;
 
 namespace VRThreads
@@ -22,7 +25,7 @@ namespace VRThreads
 
 	void SetSimulationParams(VtSimParams* hostParams)
 	{
-		ScopedTimerGPU timer("Solver_SetParams");
+		ScopedTimerGPU timer(TIMER_ID("Solver_SetParams"));
 		checkCudaErrors(cudaMemcpyToSymbolAsync(d_params, hostParams, sizeof(VtSimParams)));
 		h_params = *hostParams;
 	}
@@ -35,7 +38,7 @@ namespace VRThreads
 
 	void InitializePositions(glm::vec3* positions, const int start, const int count, const glm::mat4 modelMatrix)
 	{
-		ScopedTimerGPU timer("Solver_Initialize");
+		ScopedTimerGPU timer(TIMER_ID("Solver_Initialize"));
 		CUDA_CALL(InitializePositions_Kernel, count)(positions, start, count, modelMatrix);
 	}
 
@@ -58,7 +61,7 @@ namespace VRThreads
 		CONST(glm::vec3*) positions,
 		const float deltaTime)
 	{
-		ScopedTimerGPU timer("Solver_Predict");
+		ScopedTimerGPU timer(TIMER_ID("Solver_Predict"));
 		CUDA_CALL(PredictPositions_Kernel, h_params.numParticles)(predicted, velocities, positions, deltaTime);
 	}
 
@@ -110,7 +113,7 @@ namespace VRThreads
 		CONST(float*) invMasses,
 		const uint numConstraints)
 	{
-		ScopedTimerGPU timer("Solver_SolveStretch");
+		ScopedTimerGPU timer(TIMER_ID("Solver_SolveStretch"));
 		CUDA_CALL(SolveStretch_Kernel, numConstraints)(predicted, deltas, deltaCounts, stretchIndices, stretchLengths, invMasses, numConstraints);
 	}
 
@@ -181,7 +184,7 @@ namespace VRThreads
 		const uint numConstraints,
 		const float deltaTime)
 	{
-		ScopedTimerGPU timer("Solver_SolveBending");
+		ScopedTimerGPU timer(TIMER_ID("Solver_SolveBending"));
 		CUDA_CALL(SolveBending_Kernel, numConstraints)(predicted, deltas, deltaCounts, bendingIndices, bendingAngles, invMass, numConstraints, deltaTime);
 	}
 
@@ -228,7 +231,7 @@ namespace VRThreads
 		CONST(float*) attachDistances,
 		const int numConstraints)
 	{
-		ScopedTimerGPU timer("Solver_SolveAttach");
+		ScopedTimerGPU timer(TIMER_ID("Solver_SolveAttach"));
 		CUDA_CALL(SolveAttachment_Kernel, numConstraints)(predicted, deltas, deltaCounts, 
 			invMass, attachParticleIDs, attachSlotIDs, attachSlotPositions, attachDistances, numConstraints);
 	}
@@ -248,7 +251,7 @@ namespace VRThreads
 
 	void ApplyDeltas(glm::vec3* predicted, glm::vec3* deltas, int* deltaCounts)
 	{
-		ScopedTimerGPU timer("Solver_ApplyDeltas");
+		ScopedTimerGPU timer(TIMER_ID("Solver_ApplyDeltas"));
 		CUDA_CALL(ApplyDeltas_Kernel, h_params.numParticles)(predicted, deltas, deltaCounts);
 	}
 
@@ -284,12 +287,13 @@ namespace VRThreads
 		{
 			auto collider = colliders[i];
 			// TODO OH: this is the place the collider SDF is called
-			glm::vec3 correction = collider.ComputeSDF(pred, d_params.collisionMargin);
+			glm::vec3 velocity;
+			glm::vec3 correction = collider.ComputeSDF(pred, d_params.collisionMargin, velocity);
 			pred += correction;
 
 			if (glm::dot(correction, correction) > 0)
 			{
-				glm::vec3 relVel = pred - pos - collider.VelocityAt(pred) * deltaTime;
+				glm::vec3 relVel = pred - pos - velocity * deltaTime;
 				auto friction = ComputeFriction(correction, relVel);
 				pred += friction;
 			}
@@ -305,7 +309,7 @@ namespace VRThreads
 		const uint numColliders,
 		const float deltaTime)
 	{
-		ScopedTimerGPU timer("Solver_CollideSDFs");
+		ScopedTimerGPU timer(TIMER_ID("Solver_CollideSDFs"));
 		if (numColliders == 0) return;
 		
 		CUDA_CALL(CollideSDF_Kernel, h_params.numParticles)(predicted, colliders, positions, numColliders, deltaTime);
@@ -365,7 +369,7 @@ namespace VRThreads
 		CONST(uint*) neighbors,
 		CONST(glm::vec3*) positions)
 	{
-		ScopedTimerGPU timer("Solver_CollideParticles");
+		ScopedTimerGPU timer(TIMER_ID("Solver_CollideParticles"));
 		CUDA_CALL(CollideParticles_Kernel, h_params.numParticles)(deltas, deltaCounts, predicted, invMasses, neighbors, positions);
 		CUDA_CALL(ApplyDeltas_Kernel, h_params.numParticles)(predicted, deltas, deltaCounts);
 	}
@@ -397,12 +401,12 @@ namespace VRThreads
 		CONST(glm::vec3*) predicted,
 		const float deltaTime)
 	{
-		ScopedTimerGPU timer("Solver_Finalize");
+		ScopedTimerGPU timer(TIMER_ID("Solver_Finalize"));
 		CUDA_CALL(Finalize_Kernel, h_params.numParticles)(velocities, positions, predicted, deltaTime);
 	}
 
 	__global__ void ComputeTriangleNormals(
-		glm::vec3* normals,
+		glm::vec3* triangleNormals,
 		CONST(glm::vec3*) positions,
 		CONST(uint*) indices,
 		uint numTriangles)
@@ -416,37 +420,62 @@ namespace VRThreads
 		auto p2 = positions[idx2];
 		auto p3 = positions[idx3];
 
-		auto normal = glm::cross(p2 - p1, p3 - p1);
-		//if (isnan(normal.x) || isnan(normal.y) || isnan(normal.z)) normal = glm::vec3(0, 1, 0);
-
-		int reorder = idx1 + idx2 + idx3;
-		AtomicAdd(normals, idx1, normal, reorder);
-		AtomicAdd(normals, idx2, normal, reorder);
-		AtomicAdd(normals, idx3, normal, reorder);
+		triangleNormals[id] = glm::cross(p2 - p1, p3 - p1);
 	}
 
-	__global__ void ComputeVertexNormals(glm::vec3* normals)
+	// Gathers the triangles of each vertex in a fixed order, so unlike atomics the result doesn't depend on scheduling
+	__global__ void ComputeVertexNormals(
+		glm::vec3* normals,
+		CONST(glm::vec3*) triangleNormals,
+		CONST(uint*) normalOffsets,
+		CONST(uint*) normalTriangles)
 	{
 		GET_CUDA_ID(id, d_params.numParticles);
 
-		auto normal = glm::normalize(normals[id]);
-		//normals[id] = glm::vec3(0,1,0);
-		normals[id] = normal;
+		glm::vec3 normal = glm::vec3(0);
+		for (uint k = normalOffsets[id]; k < normalOffsets[id + 1]; k++)
+		{
+			normal += triangleNormals[normalTriangles[k]];
+		}
+		float length = glm::length(normal);
+		normals[id] = length > 0 ? normal / length : glm::vec3(0, 1, 0);
 	}
 
 	void ComputeNormal(
 		glm::vec3* normals,
+		glm::vec3* triangleNormals,
 		CONST(glm::vec3*) positions, 
 		CONST(uint*) indices, 
+		CONST(uint*) normalOffsets,
+		CONST(uint*) normalTriangles,
 		const uint numTriangles)
 	{
-		ScopedTimerGPU timer("Solver_UpdateNormals");
+		ScopedTimerGPU timer(TIMER_ID("Solver_UpdateNormals"));
 		if (h_params.numParticles)
 		{
-			cudaMemsetAsync(normals, 0, h_params.numParticles * sizeof(glm::vec3));
-			CUDA_CALL(ComputeTriangleNormals, numTriangles)(normals, positions, indices, numTriangles);
-			CUDA_CALL(ComputeVertexNormals, h_params.numParticles)(normals);
+			CUDA_CALL(ComputeTriangleNormals, numTriangles)(triangleNormals, positions, indices, numTriangles);
+			CUDA_CALL(ComputeVertexNormals, h_params.numParticles)(normals, triangleNormals, normalOffsets, normalTriangles);
+		}
+	}
+
+	struct Distance2
+	{
+		__device__ float operator()(const glm::vec3& a, const glm::vec3& b) const
+		{
+			return length2(a - b);
 		}
+	};
+
+	float MaxDisplacement(
+		CONST(glm::vec3*) positions,
+		CONST(glm::vec3*) reference,
+		const uint count)
+	{
+		if (count == 0) return 0;
+		thrust::device_ptr<const glm::vec3> first(positions);
+		thrust::device_ptr<const glm::vec3> other(reference);
+		float maxDistance2 = thrust::inner_product(first, first + count, other, 0.0f, thrust::maximum<float>(), Distance2());
+		return sqrt(maxDistance2);
 	}
 
 }
\ No newline at end of file
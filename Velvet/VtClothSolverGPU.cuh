@@ -5,97 +5,6 @@
 
 namespace VRThreads
 {
-	struct SDFCollider
-	{
-		ColliderType type;
-
-		glm::vec3 position;
-		glm::vec3 scale;
-
-		float deltaTime;
-		glm::mat3 curTransform;
-		glm::mat4 invCurTransform;
-		glm::mat4 lastTransform;
-
-		__device__ float sgn(float value) const { return (value > 0) ? 1.0f : (value < 0 ? -1.0f : 0.0f); }
-
-		__device__ glm::vec3 ComputeSDF(const glm::vec3 targetPosition, const float collisionMargin) const
-		{
-			if (type == ColliderType::Plane)
-			{
-				float offset = targetPosition.y - (position.y + collisionMargin);
-				if (offset < 0)
-				{
-					return glm::vec3(0, -offset, 0);
-				}
-			}
-			else if (type == ColliderType::Sphere)
-			{
-				float radius = scale.x + collisionMargin;
-				auto diff = targetPosition - position;
-				float distance = glm::length(diff);
-				float offset = distance - radius;
-				if (offset < 0)
-				{
-					glm::vec3 direction = diff / distance;
-					return -offset * direction;
-				}
-			}
-			else if (type == ColliderType::Cube)
-			{
-				glm::vec3 correction = glm::vec3(0);
-				glm::vec3 localPos = invCurTransform * glm::vec4(targetPosition, 1.0);
-				glm::vec3 cubeSize = glm::vec3(0.5f, 0.5f, 0.5f) + collisionMargin / scale;
-				glm::vec3 offset = glm::abs(localPos) - cubeSize;
-
-				float maxVal = max(offset.x, max(offset.y, offset.z));
-				float minVal = min(offset.x, min(offset.y, offset.z)); 
-				float midVal = offset.x  + offset.y + offset.z - maxVal - minVal;
-				float scalar = 1.0f;
-
-				if (maxVal < 0)
-				{
-					// make cube corner round to avoid particle vibration	
-					float margin = 0.03f;
-					if (midVal > -margin) scalar = 0.2f;
-					if (minVal > -margin)
-					{
-						glm::vec3 mask;
-						mask.x = offset.x < 0 ? sgn(localPos.x) : 0;
-						mask.y = offset.y < 0 ? sgn(localPos.y) : 0;
-						mask.z = offset.z < 0 ? sgn(localPos.z) : 0;
-
-						glm::vec3 vec = offset + glm::vec3(margin);
-						float len = glm::length(vec);
-						if (len < margin)
-							correction = mask * glm::normalize(vec) * (margin - len);
-					}
-					else if (offset.x == maxVal)
-					{
-						correction = glm::vec3(copysignf(-offset.x, localPos.x), 0, 0);
-					}
-					else if (offset.y == maxVal)
-					{
-						correction = glm::vec3(0, copysignf(-offset.y, localPos.y), 0);
-					}
-					else if (offset.z == maxVal)
-					{
-						correction = glm::vec3(0, 0, copysignf(-offset.z, localPos.z));
-					}
-				}
-				return curTransform * scalar * correction;
-			}
-			return glm::vec3(0);
-		}
-	
-		__device__ glm::vec3 VelocityAt(const glm::vec3 targetPosition)
-		{
-			glm::vec4 lastPos = lastTransform * invCurTransform * glm::vec4(targetPosition, 1.0);
-			glm::vec3 vel = (targetPosition - glm::vec3(lastPos)) / deltaTime;
-			return vel;
-		}
-	};
-
 	void SetSimulationParams(VtSimParams* hostParams);
 
 	void InitializePositions(glm::vec3* positions, const int start, const int count, const glm::mat4 modelMatrix);
@@ -165,7 +74,16 @@ namespace VRThreads
 
 	void ComputeNormal(
 		glm::vec3* normals,
+		glm::vec3* triangleNormals,
 		CONST(glm::vec3*) positions,
 		CONST(uint*) indices,
+		CONST(uint*) normalOffsets,
+		CONST(uint*) normalTriangles,
 		const uint numTriangles);
+
+	// Largest distance between positions[i] and reference[i]
+	float MaxDisplacement(
+		CONST(glm::vec3*) positions,
+		CONST(glm::vec3*) reference,
+		const uint count);
 }
@@ -15,6 +15,8 @@
 #include "VtBuffer.hpp"
 #include "SpatialHashGPU.hpp"
 #include "MouseGrabber.hpp"
+#include "VtClothCache.hpp"
+#include "VtNormals.hpp"
 
 using namespace std;
 
@@ -42,9 +44,10 @@ namespace VRThreads
 			m_mouseGrabber.UpdateGrappedVertex();
 			UpdateColliders(m_colliders);
 
-			Timer::StartTimer("GPU_TIME");
+			Timer::StartTimer(TIMER_ID("GPU_TIME"));
 			Simulate();
-			Timer::EndTimer("GPU_TIME");
+			Timer::EndTimer(TIMER_ID("GPU_TIME"));
+			UpdateBake();
 		}
 
 		void OnDestroy() override
@@ -55,7 +58,7 @@ namespace VRThreads
 
 		void Simulate()
 		{
-			Timer::StartTimerGPU("Solver_Total");
+			Timer::StartTimerGPU(TIMER_ID("Solver_Total"));
 			//==========================
 			// Prepare
 			//==========================
@@ -99,12 +102,24 @@ namespace VRThreads
 				Finalize(velocities, positions, predicted, substepTime);
 			}
 
-			ComputeNormal(normals, positions, indices, (uint)(indices.size() / 3));
+			// normals are kept while no particle moved further than normalUpdateDistance since they were computed.
+			// A negative distance recomputes them every frame, without the synchronous displacement check or the snapshot.
+			uint numParticles = Global::simParams.numParticles;
+			float updateDistance = Global::simParams.normalUpdateDistance;
+			if (m_normalsDirty || updateDistance < 0 || MaxDisplacement(positions, normalPositions, numParticles) > updateDistance)
+			{
+				ComputeNormal(normals, triangleNormals, positions, indices, normalOffsets, normalTriangles, (uint)(indices.size() / 3));
+				if (updateDistance >= 0)
+				{
+					cudaMemcpyAsync(normalPositions, positions, numParticles * sizeof(glm::vec3), cudaMemcpyDefault);
+				}
+				m_normalsDirty = updateDistance < 0;
+			}
 
 			//==========================
 			// Sync
 			//==========================
-			Timer::EndTimerGPU("Solver_Total");
+			Timer::EndTimerGPU(TIMER_ID("Solver_Total"));
 			cudaDeviceSynchronize();
 
 			positions.sync();
@@ -134,6 +149,17 @@ namespace VRThreads
 				indices.push_back(mesh->indices()[i] + prevNumParticles);
 			}
 
+			// vertex to triangle adjacency of all cloths for the normals
+			vector<uint> offsets, triangles;
+			VtNormals::BuildAdjacency(indices.data(), indices.size(), Global::simParams.numParticles, offsets, triangles);
+			normalOffsets.resize(0);
+			normalOffsets.push_back(offsets);
+			normalTriangles.resize(0);
+			normalTriangles.push_back(triangles);
+			triangleNormals.resize(indices.size() / 3);
+			normalPositions.resize(Global::simParams.numParticles);
+			m_normalsDirty = true;
+
 			velocities.push_back(newParticles, glm::vec3(0));
 			predicted.push_back(newParticles, glm::vec3(0));
 			deltas.push_back(newParticles, glm::vec3(0));
@@ -193,15 +219,7 @@ namespace VRThreads
 			{
 				const Collider* c = colliders[i];
 				if (!c->enabled) continue;
-				SDFCollider sc;
-				sc.type = c->type;
-				sc.position = c->actor->transform->position;
-				sc.scale = c->actor->transform->scale;
-				sc.curTransform = c->curTransform;
-				sc.invCurTransform = glm::inverse(c->curTransform);
-				sc.lastTransform = c->lastTransform;
-				sc.deltaTime = Timer::fixedDeltaTime();
-				sdfColliders[i] = sc;
+				sdfColliders[i] = c->GetSDFCollider();
 			}
 		}
 
@@ -210,6 +228,10 @@ namespace VRThreads
 		VtMergedBuffer<glm::vec3> positions;
 		VtMergedBuffer<glm::vec3> normals;
 		VtBuffer<uint> indices;
+		VtBuffer<uint> normalOffsets; // triangles of vertex i are normalTriangles[normalOffsets[i], normalOffsets[i+1])
+		VtBuffer<uint> normalTriangles;
+		VtBuffer<glm::vec3> triangleNormals;
+		VtBuffer<glm::vec3> normalPositions; // positions at the last normal update
 
 		VtBuffer<glm::vec3> velocities;
 		VtBuffer<glm::vec3> predicted;
@@ -236,6 +258,22 @@ namespace VRThreads
 		shared_ptr<SpatialHashGPU> m_spatialHash; // TODO OH: used for efficient self-collision calculation
 		vector<Collider*> m_colliders;
 		MouseGrabber m_mouseGrabber;
+		VtClothCacheWriter m_cacheWriter;
+		bool m_normalsDirty = true;
+
+		// Positions and normals are managed memory, so frames are written straight from them after the solver synced
+		void UpdateBake()
+		{
+			if (Global::gameState.bakeCache && !m_cacheWriter.isOpen())
+			{
+				m_cacheWriter.Open("velvet_bake.vtc", Global::simParams.numParticles, indices.data(), indices.size(), 1.0f / Timer::fixedDeltaTime());
+			}
+			else if (!Global::gameState.bakeCache && m_cacheWriter.isOpen())
+			{
+				m_cacheWriter.Close();
+			}
+			m_cacheWriter.WriteFrame(positions, normals);
+		}
 
 		void ShowDebugGUI()
 		{
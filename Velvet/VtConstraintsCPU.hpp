@@ -0,0 +1,200 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <numeric>
+#include <algorithm>
+#include <new>
+#include <cstdint>
+
+namespace VRThreads
+{
+	using namespace std;
+
+	// Allocator for SIMD friendly buffers, the default alignment matches a cache line
+	template <class T, size_t Alignment = 64>
+	class VtAlignedAllocator
+	{
+	public:
+		using value_type = T;
+
+		template <class U>
+		struct rebind
+		{
+			using other = VtAlignedAllocator<U, Alignment>;
+		};
+
+		VtAlignedAllocator() noexcept {}
+
+		template <class U>
+		VtAlignedAllocator(const VtAlignedAllocator<U, Alignment>&) noexcept {}
+
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T), align_val_t(Alignment)));
+		}
+
+		void deallocate(T* ptr, size_t)
+		{
+			::operator delete(ptr, align_val_t(Alignment));
+		}
+
+		template <class U>
+		bool operator==(const VtAlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+		template <class U>
+		bool operator!=(const VtAlignedAllocator<U, Alignment>&) const noexcept { return false; }
+	};
+
+	template <class T>
+	using VtAlignedVector = vector<T, VtAlignedAllocator<T>>;
+
+	/// <summary>
+	/// Constraints over N particles with a single rest value, stored as structure-of-arrays.
+	/// Build() reorders the constraints by particle locality and groups them by graph color,
+	/// so a solver can stream each color linearly without two constraints touching the same particle.
+	/// </summary>
+	template <int N>
+	class VtConstraintsCPU
+	{
+	public:
+		array<VtAlignedVector<int>, N> indices; // indices[k][i] is the k-th particle of constraint i
+		VtAlignedVector<float> restValues;
+		vector<int> colorOffsets; // constraints of color i are in [offsets[i], offsets[i+1])
+
+		int size() const
+		{
+			return (int)restValues.size();
+		}
+
+		int numColors() const
+		{
+			return max(0, (int)colorOffsets.size() - 1);
+		}
+
+		void Add(const array<int, N>& particles, float restValue)
+		{
+			for (int k = 0; k < N; k++)
+			{
+				indices[k].push_back(particles[k]);
+			}
+			restValues.push_back(restValue);
+		}
+
+		// Resizes every array, new constraints are filled in by the caller
+		void Resize(int count)
+		{
+			for (auto& idx : indices) idx.resize(count);
+			restValues.resize(count);
+		}
+
+		void Clear()
+		{
+			for (auto& idx : indices) idx.clear();
+			restValues.clear();
+			colorOffsets.clear();
+		}
+
+		// Can be called again after Clear()/Add(), scratch buffers keep their capacity
+		void Build(int numParticles)
+		{
+			int count = size();
+
+			// Sort by the lowest particle first, so that neighbouring constraints touch neighbouring memory.
+			m_order.resize(count);
+			iota(m_order.begin(), m_order.end(), 0);
+			m_minParticle.resize(count);
+			for (int i = 0; i < count; i++)
+			{
+				m_minParticle[i] = indices[0][i];
+				for (int k = 1; k < N; k++) m_minParticle[i] = min(m_minParticle[i], indices[k][i]);
+			}
+			if (!is_sorted(m_minParticle.begin(), m_minParticle.end()))
+			{
+				stable_sort(m_order.begin(), m_order.end(), [this](int a, int b) {
+					return m_minParticle[a] < m_minParticle[b];
+					});
+			}
+
+			// Greedy graph coloring: constraints of the same color share no particle, so each color can be solved
+			// across threads without atomics, while sweeping the colors in order keeps Gauss-Seidel convergence.
+			// The first 64 colors are tracked with a bit mask per particle.
+			m_colors.resize(count);
+			m_colorMasks.assign(numParticles, 0);
+			m_overflowUsed.clear(); // [color - 64][particle]
+			int numColors = 0;
+			for (int i : m_order)
+			{
+				uint64_t used = 0;
+				for (int k = 0; k < N; k++)
+				{
+					used |= m_colorMasks[indices[k][i]];
+				}
+
+				int color = 0;
+				while (color < 64 && (used & (1ull << color))) color++;
+				for (; color >= 64 && color - 64 < (int)m_overflowUsed.size(); color++)
+				{
+					bool isFree = true;
+					for (int k = 0; k < N && isFree; k++)
+					{
+						isFree = !m_overflowUsed[color - 64][indices[k][i]];
+					}
+					if (isFree) break;
+				}
+				if (color >= 64 && color - 64 == (int)m_overflowUsed.size())
+				{
+					m_overflowUsed.emplace_back(numParticles, false);
+				}
+
+				for (int k = 0; k < N; k++)
+				{
+					if (color < 64) m_colorMasks[indices[k][i]] |= 1ull << color;
+					else m_overflowUsed[color - 64][indices[k][i]] = true;
+				}
+				m_colors[i] = color;
+				numColors = max(numColors, color + 1);
+			}
+
+			// stable counting sort by color keeps the locality order inside each color
+			colorOffsets.assign(numColors + 1, 0);
+			for (int color : m_colors) colorOffsets[color + 1]++;
+			for (int color = 0; color < numColors; color++) colorOffsets[color + 1] += colorOffsets[color];
+
+			m_cursor.assign(colorOffsets.begin(), colorOffsets.end() - 1);
+			m_permutation.resize(count);
+			for (int i : m_order)
+			{
+				m_permutation[m_cursor[m_colors[i]]++] = i;
+			}
+
+			for (int k = 0; k < N; k++)
+			{
+				Permute(indices[k], m_scratchIndices);
+			}
+			Permute(restValues, m_scratchValues);
+		}
+
+	private:
+		vector<int> m_order;
+		vector<int> m_minParticle;
+		vector<int> m_colors;
+		vector<uint64_t> m_colorMasks;
+		vector<vector<bool>> m_overflowUsed;
+		vector<int> m_cursor;
+		vector<int> m_permutation;
+		VtAlignedVector<int> m_scratchIndices;
+		VtAlignedVector<float> m_scratchValues;
+
+		template <class T>
+		void Permute(VtAlignedVector<T>& values, VtAlignedVector<T>& scratch)
+		{
+			scratch.resize(values.size());
+			for (int i = 0; i < m_permutation.size(); i++)
+			{
+				scratch[i] = values[m_permutation[i]];
+			}
+			values.swap(scratch);
+		}
+	};
+}
\ No newline at end of file
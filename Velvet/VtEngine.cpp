@@ -77,13 +77,15 @@ VtEngine::~VtEngine()
 	glfwTerminate();
 }
 
-void VtEngine::SetScenes(const vector<shared_ptr<Scene>>& initializers)
+void VtEngine::SetScenes(const vector<shared_ptr<Scene>>& initializers, unsigned int firstScene)
 {
 	scenes = initializers;
+	m_nextSceneIndex = std::clamp(firstScene, 0u, (unsigned int)scenes.size() - 1);
 }
 
 int VtEngine::Run()
 {
+	bool pendingReset = false;
 	do 
 	{
 #pragma warning( push )
@@ -102,9 +104,16 @@ int VtEngine::Run()
 		scenes[sceneIndex]->onExit.Invoke();
 		scenes[sceneIndex]->ClearCallbacks();
 
-		Resource::ClearCache();
 		m_gui->ClearCallback();
-	} while (m_game->pendingReset);
+
+		// destroy the finished scene first, so the assets only it used are unreferenced when the cache is trimmed
+		pendingReset = m_game->pendingReset;
+		m_game.reset();
+		Resource::ReleaseUnused();
+	} while (pendingReset);
+
+	// meshes and materials free their GL objects, which needs the context that ~VtEngine terminates
+	Resource::ClearCache();
 
 	return 0;
 }
@@ -27,7 +27,7 @@ namespace VRThreads
 
 		void Reset();
 		void SwitchScene(unsigned int sceneIndex);
-		void SetScenes(const vector<shared_ptr<Scene>>& scenes);
+		void SetScenes(const vector<shared_ptr<Scene>>& scenes, unsigned int firstScene = 0);
 
 		glm::ivec2 windowSize();
 
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <utility>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Global.hpp"
+#include "Helper.hpp"
+#include "Timer.hpp"
+#include "VtClothSolverCPU.hpp"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	struct VtClothGeometry
+	{
+		vector<glm::vec3> positions;
+		vector<glm::vec2> uvs;
+		vector<unsigned int> indices;
+	};
+
+	// Regular cloth grid in model space, shared by Scene::GenerateClothMesh and the headless scenes
+	inline VtClothGeometry GenerateClothGeometry(int resolution)
+	{
+		VtClothGeometry geometry;
+		const float clothSize = 2.0f;
+
+		for (int y = 0; y <= resolution; y++)
+		{
+			for (int x = 0; x <= resolution; x++)
+			{
+				geometry.positions.push_back(clothSize * glm::vec3((float)x / (float)resolution - 0.5f, -(float)y / (float)resolution, 0));
+				geometry.uvs.push_back(glm::vec2((float)x / (float)resolution, (float)y / (float)resolution));
+			}
+		}
+
+		auto VertexIndexAt = [resolution](int x, int y) {
+			return x * (resolution + 1) + y;
+		};
+
+		auto& indices = geometry.indices;
+		for (int x = 0; x < resolution; x++)
+		{
+			for (int y = 0; y < resolution; y++)
+			{
+				indices.push_back(VertexIndexAt(x, y));
+				indices.push_back(VertexIndexAt(x + 1, y));
+				indices.push_back(VertexIndexAt(x, y + 1));
+
+				indices.push_back(VertexIndexAt(x, y + 1));
+				indices.push_back(VertexIndexAt(x + 1, y));
+				indices.push_back(VertexIndexAt(x + 1, y + 1));
+			}
+		}
+		return geometry;
+	}
+
+	// Same as Transform::matrix()
+	inline glm::mat4 ModelMatrix(glm::vec3 position, glm::vec3 scale, glm::vec3 rotation = glm::vec3(0))
+	{
+		glm::mat4 result = glm::mat4(1.0f);
+		result = glm::translate(result, position);
+		result = Helper::RotateWithDegree(result, rotation);
+		result = glm::scale(result, scale);
+		return result;
+	}
+
+	// Collider without an actor. Mirrors the Collider component: the transform of the previous frame is kept for VelocityAt().
+	struct VtHeadlessCollider
+	{
+		ColliderType type = ColliderType::Sphere;
+		glm::vec3 position = glm::vec3(0);
+		glm::vec3 scale = glm::vec3(1);
+		glm::vec3 rotation = glm::vec3(0);
+
+		// Moves the collider at the given time (seconds since the first frame), like game->animationUpdate
+		function<void(VtHeadlessCollider&, float)> animate;
+
+		glm::mat4 curTransform = glm::mat4(1);
+		glm::mat4 lastTransform = glm::mat4(1);
+
+		void Start()
+		{
+			curTransform = ModelMatrix(position, scale, rotation);
+			lastTransform = curTransform;
+		}
+
+		void FixedUpdate(float time)
+		{
+			if (animate) animate(*this, time);
+			lastTransform = curTransform;
+			curTransform = ModelMatrix(position, scale, rotation);
+		}
+
+		SDFCollider GetSDFCollider(float deltaTime) const
+		{
+			SDFCollider sc;
+			sc.type = type;
+			sc.position = position;
+			sc.scale = scale;
+			sc.curTransform = curTransform;
+			sc.invCurTransform = glm::inverse(curTransform);
+			sc.lastTransform = lastTransform;
+			sc.deltaTime = deltaTime;
+			return sc;
+		}
+	};
+
+	struct VtHeadlessCloth
+	{
+		int resolution = 16;
+		glm::vec3 position = glm::vec3(0);
+		glm::vec3 scale = glm::vec3(1);
+		glm::vec3 rotation = glm::vec3(0);
+		vector<int> attachedIndices;
+		int texture = 1;				// fabric texture in the editor
+
+		glm::mat4 modelMatrix() const
+		{
+			return ModelMatrix(position, scale, rotation);
+		}
+	};
+
+	/// <summary>
+	/// Physics description of a cloth scene: cloths, colliders and parameter overrides. This is the only definition
+	/// of these scenes, the editor scenes in main.cpp spawn their actors from it (see Scene::SpawnDescription), and
+	/// velvet_headless and the benchmark run it without a window or GL context, e.g. on a server.
+	/// </summary>
+	struct VtHeadlessScene
+	{
+		string name;
+		vector<VtHeadlessCloth> cloths;
+		vector<VtHeadlessCollider> colliders;
+		vector<pair<int VtSimParams::*, int>> intParams;
+		vector<pair<float VtSimParams::*, float>> floatParams;
+		bool sharedSolver = false;		// the editor simulates all cloths with one GPU solver
+
+		void SetParam(int VtSimParams::* param, int value)
+		{
+			intParams.push_back({ param, value });
+		}
+
+		void SetParam(float VtSimParams::* param, float value)
+		{
+			floatParams.push_back({ param, value });
+		}
+
+		void ApplyParams(VtSimParams& params) const
+		{
+			for (const auto& p : intParams) params.*p.first = p.second;
+			for (const auto& p : floatParams) params.*p.first = p.second;
+		}
+
+		// Attached corners as in SceneClothAttach
+		static vector<int> Corners(int resolution)
+		{
+			return { 0, resolution, (resolution + 1) * (resolution + 1) - 1, (resolution + 1) * (resolution) };
+		}
+
+		static VtHeadlessCloth Cloth(int resolution, glm::vec3 position, glm::vec3 rotation = glm::vec3(0), int texture = 1)
+		{
+			VtHeadlessCloth cloth;
+			cloth.resolution = resolution;
+			cloth.position = position;
+			cloth.rotation = rotation;
+			cloth.texture = texture;
+			return cloth;
+		}
+
+		static VtHeadlessCollider Plane()
+		{
+			VtHeadlessCollider plane;
+			plane.type = ColliderType::Plane;
+			return plane;
+		}
+
+		static VtHeadlessCollider Sphere(glm::vec3 position, float radius)
+		{
+			VtHeadlessCollider sphere;
+			sphere.type = ColliderType::Sphere;
+			sphere.position = position;
+			sphere.scale = glm::vec3(radius);
+			return sphere;
+		}
+
+		static VtHeadlessCollider Cube(glm::vec3 position, glm::vec3 scale)
+		{
+			VtHeadlessCollider cube;
+			cube.type = ColliderType::Cube;
+			cube.position = position;
+			cube.scale = scale;
+			return cube;
+		}
+
+		// resolution overrides the cloth resolution of every scene when positive
+		static vector<VtHeadlessScene> All(int resolutionOverride = 0)
+		{
+			vector<VtHeadlessScene> scenes;
+			auto Resolution = [resolutionOverride](int resolution) {
+				return resolutionOverride > 0 ? resolutionOverride : resolution;
+			};
+
+			{
+				VtHeadlessScene scene;
+				scene.name = "Attach";
+				int resolution = Resolution(40);
+				auto cloth = Cloth(resolution, glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(90, 0, 0));
+				cloth.attachedIndices = Corners(resolution);
+				scene.cloths.push_back(cloth);
+				scene.colliders = { Plane(), Sphere(glm::vec3(0, 0.5f, 0), 0.5f) };
+				scenes.push_back(scene);
+			}
+			{
+				VtHeadlessScene scene;
+				scene.name = "Collision";
+				int resolution = Resolution(16);
+				float radius = 0.6f;
+				auto cloth = Cloth(resolution, glm::vec3(0, 2.5f, 0), glm::vec3(0), 2);
+				cloth.attachedIndices = { 0, resolution };
+				scene.cloths.push_back(cloth);
+				auto sphere = Sphere(glm::vec3(0, radius, -1), radius);
+				sphere.animate = [radius](VtHeadlessCollider& c, float time) {
+					c.position = glm::vec3(0, radius, -cos(time * 2));
+				};
+				scene.colliders = { Plane(), sphere };
+				scenes.push_back(scene);
+			}
+			{
+				VtHeadlessScene scene;
+				scene.name = "SelfCollision";
+				scene.cloths.push_back(Cloth(Resolution(60), glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(-15, 10, 10)));
+				scene.colliders = { Plane() };
+				scene.SetParam(&VtSimParams::numSubsteps, 8);
+				scene.SetParam(&VtSimParams::friction, 0.3f);
+				scenes.push_back(scene);
+			}
+			{
+				VtHeadlessScene scene;
+				scene.name = "Friction";
+				float radius = 0.5f;
+				scene.cloths.push_back(Cloth(Resolution(64), glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(90, 0, 0), 2));
+				auto sphere = Sphere(glm::vec3(0, radius, 0), radius);
+				sphere.animate = [radius](VtHeadlessCollider& c, float time) {
+					time -= 0.5f;
+					if (time > 0)
+					{
+						c.position = glm::vec3(sin(time), radius, 0);
+					}
+					c.rotation = glm::vec3(0, ((int)time % 4 > 1) ? -time * 180 : time * 180, 0);
+				};
+				scene.colliders = { Plane(), sphere };
+				scene.SetParam(&VtSimParams::friction, 0.6f);
+				scene.SetParam(&VtSimParams::numSubsteps, 5);
+				scene.SetParam(&VtSimParams::numIterations, 5);
+				scenes.push_back(scene);
+			}
+			{
+				VtHeadlessScene scene;
+				scene.name = "Multiple";
+				scene.sharedSolver = true;
+				int texture = 1;
+				for (float height : { 1.5f, 1.8f, 2.1f })
+				{
+					scene.cloths.push_back(Cloth(Resolution(64), glm::vec3(0.0f, height, 1.0f), glm::vec3(90, 0, 0), texture++));
+				}
+				scene.colliders = { Plane(), Cube(glm::vec3(0, 0.5f, 0), glm::vec3(1.0f)) };
+				scene.SetParam(&VtSimParams::friction, 0.6f);
+				scene.SetParam(&VtSimParams::numSubsteps, 5);
+				scene.SetParam(&VtSimParams::numIterations, 5);
+				scenes.push_back(scene);
+			}
+			{
+				VtHeadlessScene scene;
+				scene.name = "HD";
+				float radius = 0.6f;
+				scene.cloths.push_back(Cloth(Resolution(200), glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(90, 0, 0), 2));
+				scene.colliders = { Plane(), Sphere(glm::vec3(0, radius, 0), radius) };
+				scene.SetParam(&VtSimParams::numSubsteps, 10);
+				scene.SetParam(&VtSimParams::numIterations, 10);
+				scenes.push_back(scene);
+			}
+			return scenes;
+		}
+
+		static VtHeadlessScene Find(const string& name, int resolutionOverride = 0)
+		{
+			for (auto& scene : All(resolutionOverride))
+			{
+				if (scene.name == name) return scene;
+			}
+			return VtHeadlessScene();
+		}
+	};
+
+	/// <summary>
+	/// Runs the physics of a VtHeadlessScene with the CPU solver, one solver per cloth and one thread pool for all of them.
+	/// Global::simParams must be set up before Initialize().
+	/// </summary>
+	class VtHeadlessSimulation
+	{
+	public:
+		vector<shared_ptr<VtClothSolverCPU>> solvers;
+		vector<VtClothGeometry> geometries;
+		shared_ptr<VtThreadPool> threadPool; // shared by all solvers, numCpuThreads threads
+
+		void Initialize(const VtHeadlessScene& scene)
+		{
+			m_colliders = scene.colliders;
+			threadPool = make_shared<VtThreadPool>(Global::simParams.numCpuThreads);
+			for (const auto& cloth : scene.cloths)
+			{
+				auto geometry = GenerateClothGeometry(cloth.resolution);
+				auto positions = geometry.positions;
+				for (auto& position : positions)
+				{
+					position = cloth.modelMatrix() * glm::vec4(position, 1.0f);
+				}
+
+				auto solver = make_shared<VtClothSolverCPU>(cloth.resolution);
+				solver->SetThreadPool(threadPool);
+				solver->SetAttachedIndices(cloth.attachedIndices);
+				solver->Initialize(move(positions), geometry.indices);
+				solvers.push_back(solver);
+				geometries.push_back(geometry);
+			}
+
+			for (auto& collider : m_colliders)
+			{
+				collider.Start();
+			}
+		}
+
+		// Simulates one fixed frame, solver phases are timed with the "Solver_" labels of the current Timer frame
+		void Step()
+		{
+			Timer::NextFrame();
+			m_frame++;
+
+			// same as Timer::fixedDeltaTime() * Timer::physicsFrameCount() in the editor
+			float deltaTime = Timer::fixedDeltaTime();
+			float time = deltaTime * m_frame;
+			m_sdfColliders.clear();
+			for (auto& collider : m_colliders)
+			{
+				collider.FixedUpdate(time);
+				m_sdfColliders.push_back(collider.GetSDFCollider(deltaTime));
+			}
+
+			for (auto& solver : solvers)
+			{
+				solver->SetColliders(m_sdfColliders);
+				solver->Simulate();
+			}
+		}
+
+		int numParticles() const
+		{
+			int count = 0;
+			for (const auto& solver : solvers) count += (int)solver->m_positions.size();
+			return count;
+		}
+
+	private:
+		int m_frame = 0;
+		vector<VtHeadlessCollider> m_colliders;
+		vector<SDFCollider> m_sdfColliders;
+	};
+}
\ No newline at end of file
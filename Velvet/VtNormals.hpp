@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "VtThreadPool.hpp"
+
+namespace VRThreads
+{
+	using namespace std;
+
+	/// <summary>
+	/// Vertex normals gathered from the triangles around each vertex instead of scattered from each triangle.
+	/// The vertex to triangle adjacency is built once per topology in CSR form, the triangles of vertex i are
+	/// triangles[offsets[i], offsets[i+1]) in ascending order. Every vertex sums its face normals in that order,
+	/// so the normals are the same for any number of threads (and the same as a serial scatter).
+	/// Vertices without area around them get the up vector. The GPU solver uploads the adjacency and runs the same
+	/// gather in a kernel, cloth playback and mesh sequences use it for frames that come without normals.
+	/// </summary>
+	class VtNormals
+	{
+	public:
+		static void BuildAdjacency(const unsigned int* indices, size_t numIndices, int numVertices,
+			vector<unsigned int>& offsets, vector<unsigned int>& triangles)
+		{
+			size_t numCorners = numIndices / 3 * 3;
+			offsets.assign(numVertices + 1, 0);
+			for (size_t i = 0; i < numCorners; i++)
+			{
+				offsets[indices[i] + 1]++;
+			}
+			for (int i = 0; i < numVertices; i++)
+			{
+				offsets[i + 1] += offsets[i];
+			}
+
+			vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+			triangles.resize(numCorners);
+			for (size_t i = 0; i < numCorners; i++)
+			{
+				triangles[cursor[indices[i]]++] = (unsigned int)(i / 3);
+			}
+		}
+
+		// Call again when the topology changes
+		void Initialize(const vector<unsigned int>& indices, int numVertices)
+		{
+			m_indices = indices;
+			BuildAdjacency(m_indices.data(), m_indices.size(), numVertices, m_offsets, m_triangles);
+			m_faceNormals.resize(m_indices.size() / 3);
+		}
+
+		void Compute(const vector<glm::vec3>& positions, vector<glm::vec3>& normals, VtThreadPool& threadPool)
+		{
+			normals.resize(numVertices());
+			Compute(positions.data(), normals.data(), threadPool);
+		}
+
+		// normals holds one entry per vertex, e.g. a managed buffer that the GPU reads
+		void Compute(const glm::vec3* positions, glm::vec3* normals, VtThreadPool& threadPool)
+		{
+			threadPool.ParallelFor(numTriangles(), [this, positions](int begin, int end, int) {
+				ComputeFaceNormals(positions, begin, end);
+				}, k_grainSize);
+			threadPool.ParallelFor(numVertices(), [this, normals](int begin, int end, int) {
+				GatherNormals(normals, begin, end);
+				}, k_grainSize);
+		}
+
+		// On the calling thread, for meshes that are updated once per displayed frame
+		void Compute(const glm::vec3* positions, glm::vec3* normals)
+		{
+			ComputeFaceNormals(positions, 0, numTriangles());
+			GatherNormals(normals, 0, numVertices());
+		}
+
+		int numVertices() const
+		{
+			return (int)m_offsets.size() - 1;
+		}
+
+	private:
+		const int k_grainSize = 1024;
+
+		vector<unsigned int> m_indices;
+		vector<unsigned int> m_offsets;
+		vector<unsigned int> m_triangles;
+		vector<glm::vec3> m_faceNormals;
+
+		int numTriangles() const
+		{
+			return (int)m_faceNormals.size();
+		}
+
+		void ComputeFaceNormals(const glm::vec3* positions, int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				auto p1 = positions[m_indices[i * 3]];
+				auto p2 = positions[m_indices[i * 3 + 1]];
+				auto p3 = positions[m_indices[i * 3 + 2]];
+				m_faceNormals[i] = glm::cross(p2 - p1, p3 - p1);
+			}
+		}
+
+		void GatherNormals(glm::vec3* normals, int begin, int end) const
+		{
+			for (int i = begin; i < end; i++)
+			{
+				glm::vec3 normal = glm::vec3(0);
+				for (unsigned int k = m_offsets[i]; k < m_offsets[i + 1]; k++)
+				{
+					normal += m_faceNormals[m_triangles[k]];
+				}
+				float length = glm::length(normal);
+				normals[i] = length > 0 ? normal / length : glm::vec3(0, 1, 0);
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC accepts AVX intrinsics in any function, the instruction set is picked at runtime
+#define VT_TARGET_AVX2
+#define VT_TARGET_AVX512
+#else
+#define VT_TARGET_AVX2 __attribute__((target("avx2")))
+#define VT_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace VRThreads
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		AVX2,
+		AVX512,
+	};
+
+	// Solves stretch constraints [begin, end) of a single graph color, lanes never share a particle.
+	// predicted is an array of xyz triples. Returns the first constraint left for the scalar path.
+	using StretchKernel = int (*)(float* predicted, const float* inverseMass, const int* idx1, const int* idx2,
+		const float* restLength, int begin, int end);
+
+	namespace VtSimdCPU
+	{
+		inline SimdLevel DetectLevel()
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) return SimdLevel::Scalar;
+
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx) return SimdLevel::Scalar;
+
+			// the OS has to save ymm (and zmm) registers on context switch
+			unsigned long long xcr0 = _xgetbv(0);
+			if ((xcr0 & 0x6) != 0x6) return SimdLevel::Scalar;
+
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+			bool avx512f = (info[1] & (1 << 16)) != 0;
+			if (avx512f && (xcr0 & 0xe6) == 0xe6) return SimdLevel::AVX512;
+			if (avx2) return SimdLevel::AVX2;
+			return SimdLevel::Scalar;
+#else
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+			if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+			return SimdLevel::Scalar;
+#endif
+		}
+
+		inline const char* LevelName(SimdLevel level)
+		{
+			switch (level)
+			{
+			case SimdLevel::AVX2:
+				return "AVX2";
+			case SimdLevel::AVX512:
+				return "AVX-512";
+			default:
+				return "Scalar";
+			}
+		}
+
+		// Same math and operation order as VtClothSolverCPU::SolveStretchConstraint
+		VT_TARGET_AVX2 inline int SolveStretchAVX2(float* predicted, const float* inverseMass, const int* idx1, const int* idx2,
+			const float* restLength, int begin, int end)
+		{
+			const __m256i three = _mm256_set1_epi32(3);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m256 epsilon = _mm256_set1_ps(1e-6f);
+
+			alignas(32) int offset1[8], offset2[8];
+			alignas(32) float out[6][8];
+
+			int i = begin;
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256i i1 = _mm256_loadu_si256((const __m256i*)(idx1 + i));
+				__m256i i2 = _mm256_loadu_si256((const __m256i*)(idx2 + i));
+				__m256i o1 = _mm256_mullo_epi32(i1, three);
+				__m256i o2 = _mm256_mullo_epi32(i2, three);
+
+				__m256 x1 = _mm256_i32gather_ps(predicted, o1, 4);
+				__m256 y1 = _mm256_i32gather_ps(predicted + 1, o1, 4);
+				__m256 z1 = _mm256_i32gather_ps(predicted + 2, o1, 4);
+				__m256 x2 = _mm256_i32gather_ps(predicted, o2, 4);
+				__m256 y2 = _mm256_i32gather_ps(predicted + 1, o2, 4);
+				__m256 z2 = _mm256_i32gather_ps(predicted + 2, o2, 4);
+				__m256 w1 = _mm256_i32gather_ps(inverseMass, i1, 4);
+				__m256 w2 = _mm256_i32gather_ps(inverseMass, i2, 4);
+				__m256 expected = _mm256_loadu_ps(restLength + i);
+
+				__m256 dx = _mm256_sub_ps(x1, x2);
+				__m256 dy = _mm256_sub_ps(y1, y2);
+				__m256 dz = _mm256_sub_ps(z1, z2);
+				__m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+				__m256 denom = _mm256_add_ps(w1, w2);
+
+				// unilateral: only pull particles together
+				__m256 active = _mm256_and_ps(_mm256_cmp_ps(distance, expected, _CMP_GT_OQ), _mm256_cmp_ps(denom, zero, _CMP_GT_OQ));
+				__m256 lambda = _mm256_div_ps(_mm256_sub_ps(distance, expected), _mm256_blendv_ps(one, denom, active));
+				lambda = _mm256_and_ps(lambda, active);
+
+				__m256 length = _mm256_add_ps(distance, epsilon);
+				__m256 gx = _mm256_div_ps(dx, length);
+				__m256 gy = _mm256_div_ps(dy, length);
+				__m256 gz = _mm256_div_ps(dz, length);
+
+				__m256 s1 = _mm256_mul_ps(w1, lambda);
+				__m256 s2 = _mm256_mul_ps(w2, lambda);
+				_mm256_store_ps(out[0], _mm256_sub_ps(x1, _mm256_mul_ps(s1, gx)));
+				_mm256_store_ps(out[1], _mm256_sub_ps(y1, _mm256_mul_ps(s1, gy)));
+				_mm256_store_ps(out[2], _mm256_sub_ps(z1, _mm256_mul_ps(s1, gz)));
+				_mm256_store_ps(out[3], _mm256_add_ps(x2, _mm256_mul_ps(s2, gx)));
+				_mm256_store_ps(out[4], _mm256_add_ps(y2, _mm256_mul_ps(s2, gy)));
+				_mm256_store_ps(out[5], _mm256_add_ps(z2, _mm256_mul_ps(s2, gz)));
+
+				// AVX2 has no scatter
+				_mm256_store_si256((__m256i*)offset1, o1);
+				_mm256_store_si256((__m256i*)offset2, o2);
+				for (int lane = 0; lane < 8; lane++)
+				{
+					predicted[offset1[lane]] = out[0][lane];
+					predicted[offset1[lane] + 1] = out[1][lane];
+					predicted[offset1[lane] + 2] = out[2][lane];
+					predicted[offset2[lane]] = out[3][lane];
+					predicted[offset2[lane] + 1] = out[4][lane];
+					predicted[offset2[lane] + 2] = out[5][lane];
+				}
+			}
+			return i;
+		}
+
+		VT_TARGET_AVX512 inline int SolveStretchAVX512(float* predicted, const float* inverseMass, const int* idx1, const int* idx2,
+			const float* restLength, int begin, int end)
+		{
+			const __m512i three = _mm512_set1_epi32(3);
+			const __m512 zero = _mm512_setzero_ps();
+			const __m512 epsilon = _mm512_set1_ps(1e-6f);
+
+			int i = begin;
+			for (; i + 16 <= end; i += 16)
+			{
+				__m512i i1 = _mm512_loadu_si512(idx1 + i);
+				__m512i i2 = _mm512_loadu_si512(idx2 + i);
+				__m512i o1 = _mm512_mullo_epi32(i1, three);
+				__m512i o2 = _mm512_mullo_epi32(i2, three);
+
+				__m512 x1 = _mm512_i32gather_ps(o1, predicted, 4);
+				__m512 y1 = _mm512_i32gather_ps(o1, predicted + 1, 4);
+				__m512 z1 = _mm512_i32gather_ps(o1, predicted + 2, 4);
+				__m512 x2 = _mm512_i32gather_ps(o2, predicted, 4);
+				__m512 y2 = _mm512_i32gather_ps(o2, predicted + 1, 4);
+				__m512 z2 = _mm512_i32gather_ps(o2, predicted + 2, 4);
+				__m512 w1 = _mm512_i32gather_ps(i1, inverseMass, 4);
+				__m512 w2 = _mm512_i32gather_ps(i2, inverseMass, 4);
+				__m512 expected = _mm512_loadu_ps(restLength + i);
+
+				__m512 dx = _mm512_sub_ps(x1, x2);
+				__m512 dy = _mm512_sub_ps(y1, y2);
+				__m512 dz = _mm512_sub_ps(z1, z2);
+				__m512 distance = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz)));
+				__m512 denom = _mm512_add_ps(w1, w2);
+
+				// unilateral: only pull particles together, inactive lanes are neither computed nor written
+				__mmask16 active = _mm512_cmp_ps_mask(distance, expected, _CMP_GT_OQ) & _mm512_cmp_ps_mask(denom, zero, _CMP_GT_OQ);
+				if (active == 0) continue;
+
+				__m512 lambda = _mm512_maskz_div_ps(active, _mm512_sub_ps(distance, expected), denom);
+				__m512 length = _mm512_add_ps(distance, epsilon);
+				__m512 gx = _mm512_div_ps(dx, length);
+				__m512 gy = _mm512_div_ps(dy, length);
+				__m512 gz = _mm512_div_ps(dz, length);
+
+				__m512 s1 = _mm512_mul_ps(w1, lambda);
+				__m512 s2 = _mm512_mul_ps(w2, lambda);
+				_mm512_mask_i32scatter_ps(predicted, active, o1, _mm512_sub_ps(x1, _mm512_mul_ps(s1, gx)), 4);
+				_mm512_mask_i32scatter_ps(predicted + 1, active, o1, _mm512_sub_ps(y1, _mm512_mul_ps(s1, gy)), 4);
+				_mm512_mask_i32scatter_ps(predicted + 2, active, o1, _mm512_sub_ps(z1, _mm512_mul_ps(s1, gz)), 4);
+				_mm512_mask_i32scatter_ps(predicted, active, o2, _mm512_add_ps(x2, _mm512_mul_ps(s2, gx)), 4);
+				_mm512_mask_i32scatter_ps(predicted + 1, active, o2, _mm512_add_ps(y2, _mm512_mul_ps(s2, gy)), 4);
+				_mm512_mask_i32scatter_ps(predicted + 2, active, o2, _mm512_add_ps(z2, _mm512_mul_ps(s2, gz)), 4);
+			}
+			return i;
+		}
+
+		inline StretchKernel SelectStretchKernel(SimdLevel level)
+		{
+			switch (level)
+			{
+			case SimdLevel::AVX2:
+				return SolveStretchAVX2;
+			case SimdLevel::AVX512:
+				return SolveStretchAVX512;
+			default:
+				return nullptr;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+namespace VRThreads
+{
+	using namespace std;
+
+	/// <summary>
+	/// Fork-join worker pool used by the CPU solver.
+	/// ParallelFor splits [0, count) into chunks and blocks until every chunk is processed.
+	/// The calling thread takes part in the work, so a pool of n threads owns n-1 workers.
+	/// </summary>
+	class VtThreadPool
+	{
+	public:
+		// func(begin, end, threadIndex), threadIndex is in [0, numThreads)
+		using RangeFunc = function<void(int, int, int)>;
+
+		VtThreadPool(int numThreads = 0)
+		{
+			if (numThreads <= 0)
+			{
+				numThreads = max(1, (int)thread::hardware_concurrency());
+			}
+			m_numThreads = numThreads;
+
+			for (int i = 1; i < m_numThreads; i++)
+			{
+				m_workers.emplace_back([this, i]() { WorkerLoop(i); });
+			}
+		}
+
+		VtThreadPool(const VtThreadPool&) = delete;
+
+		~VtThreadPool()
+		{
+			{
+				lock_guard<mutex> lock(m_mutex);
+				m_stop = true;
+				m_generation.fetch_add(1, memory_order_release);
+			}
+			m_wakeUp.notify_all();
+			for (auto& worker : m_workers)
+			{
+				worker.join();
+			}
+		}
+
+		int numThreads() const
+		{
+			return m_numThreads;
+		}
+
+		// Run func over [0, count) in chunks of grainSize. Must not be called from a worker thread.
+		void ParallelFor(int count, const RangeFunc& func, int grainSize = 256)
+		{
+			if (count <= 0) return;
+
+			grainSize = max(1, grainSize);
+			if (m_numThreads == 1 || count <= grainSize)
+			{
+				func(0, count, 0);
+				return;
+			}
+
+			m_func = &func;
+			m_count = count;
+			m_grainSize = grainSize;
+			m_nextChunk.store(0, memory_order_relaxed);
+			m_pendingWorkers.store((int)m_workers.size(), memory_order_relaxed);
+
+			{
+				lock_guard<mutex> lock(m_mutex);
+				m_generation.fetch_add(1, memory_order_release);
+			}
+			if (m_numSleeping.load(memory_order_acquire) > 0)
+			{
+				m_wakeUp.notify_all();
+			}
+
+			RunChunks(0);
+
+			// workers keep spinning for a short while after each job, so waiting here is cheap
+			while (m_pendingWorkers.load(memory_order_acquire) > 0)
+			{
+				this_thread::yield();
+			}
+			m_func = nullptr;
+		}
+
+	private:
+		static const int k_spinCount = 4096;
+
+		int m_numThreads = 1;
+		vector<thread> m_workers;
+
+		mutex m_mutex;
+		condition_variable m_wakeUp;
+		atomic<unsigned int> m_generation = 0;
+		atomic<int> m_numSleeping = 0;
+		atomic<int> m_pendingWorkers = 0;
+		atomic<int> m_nextChunk = 0;
+		bool m_stop = false;
+
+		const RangeFunc* m_func = nullptr;
+		int m_count = 0;
+		int m_grainSize = 1;
+
+		void RunChunks(int threadIndex)
+		{
+			while (true)
+			{
+				int begin = m_nextChunk.fetch_add(m_grainSize, memory_order_relaxed);
+				if (begin >= m_count) break;
+				int end = min(begin + m_grainSize, m_count);
+				(*m_func)(begin, end, threadIndex);
+			}
+		}
+
+		void WorkerLoop(int threadIndex)
+		{
+			unsigned int seenGeneration = 0;
+			while (true)
+			{
+				// spin first: solver iterations issue many short jobs back to back
+				int spin = 0;
+				while (m_generation.load(memory_order_acquire) == seenGeneration && spin < k_spinCount)
+				{
+					this_thread::yield();
+					spin++;
+				}
+
+				if (m_generation.load(memory_order_acquire) == seenGeneration)
+				{
+					unique_lock<mutex> lock(m_mutex);
+					m_numSleeping.fetch_add(1, memory_order_release);
+					m_wakeUp.wait(lock, [this, seenGeneration]() {
+						return m_generation.load(memory_order_acquire) != seenGeneration;
+						});
+					m_numSleeping.fetch_sub(1, memory_order_release);
+				}
+
+				seenGeneration = m_generation.load(memory_order_acquire);
+				if (m_stop) return;
+
+				RunChunks(threadIndex);
+				m_pendingWorkers.fetch_sub(1, memory_order_acq_rel);
+			}
+		}
+	};
+}
\ No newline at end of file
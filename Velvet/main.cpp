@@ -43,6 +43,10 @@ public:
 		{
 			avatar->AddComponent(renderer);
 			avatar->AddComponent(_meshAnimation);
+			// after the animation, which it follows. The GPU solver leaves the CPU free, so the collider gets the
+			// scene's only thread pool.
+			auto threadPool = make_shared<VtThreadPool>(Global::simParams.numCpuThreads);
+			avatar->AddComponent(make_shared<DynamicMeshCollider>(_meshAnimation, threadPool));
 
 			// avatar->transform->position = glm::vec3(0.6f, 2.0f, 0.0);
 			avatar->transform->scale = glm::vec3(0.01f);
@@ -203,19 +207,7 @@ public:
 	void PopulateActors(GameInstance* game)  override
 	{
 		SpawnCameraAndLight(game);
-		SpawnInfinitePlane(game);
-
-		auto sphere = SpawnSphere(game);
-		float radius = 0.5f;
-		sphere->Initialize(glm::vec3(0, radius, 0), glm::vec3(radius));
-
-		int clothResolution = 40;
-		auto cloth = SpawnCloth(game, clothResolution);
-		cloth->Initialize(glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(1.0), glm::vec3(90, 0, 0));
-
-		auto clothObj = cloth->GetComponent<VtClothObjectGPU>();
-		if (clothObj) clothObj->SetAttachedIndices({ 0, clothResolution, (clothResolution + 1) * (clothResolution + 1) - 1, (clothResolution + 1) * (clothResolution) });
-
+		SpawnDescription(game, VtHeadlessScene::Find("Attach"));
 	}
 };
 
@@ -227,26 +219,28 @@ public:
 	void PopulateActors(GameInstance* game)  override
 	{
 		SpawnCameraAndLight(game);
+		SpawnDescription(game, VtHeadlessScene::Find("Collision"));
+	}
+};
 
+class SceneClothMeshCollision : public Scene
+{
+public:
+	SceneClothMeshCollision() { name = "Cloth / Mesh Collision"; }
+
+	void PopulateActors(GameInstance* game)  override
+	{
+		SpawnCameraAndLight(game);
 		SpawnInfinitePlane(game);
 
-		auto sphere = SpawnSphere(game);
-		float radius = 0.6f;
-		sphere->Initialize(glm::vec3(0, radius, -1), glm::vec3(radius));
-		game->animationUpdate.Register([sphere, game, radius]() {
-			float time = Timer::fixedDeltaTime() * Timer::physicsFrameCount();
-			sphere->transform->position = glm::vec3(0, radius, -cos(time * 2));
-			});
+		// cylinder.obj is as wide as it is high, the cloth drapes over its rim
+		auto drum = SpawnMesh(game, "cylinder.obj");
+		float scale = 0.4f;
+		drum->Initialize(glm::vec3(0, 0.5f * scale, 0), glm::vec3(scale));
 
-		int clothResolution = 16;
-		auto cloth = SpawnCloth(game, clothResolution, 2);
-		cloth->Initialize(glm::vec3(0, 2.5f, 0), glm::vec3(1.0));
-#ifdef SOLVER_CPU
-		auto clothObj = cloth->GetComponent<VtClothObject>();
-#else
-		auto clothObj = cloth->GetComponent<VtClothObjectGPU>();
-#endif
-		if (clothObj) clothObj->SetAttachedIndices({ 0, clothResolution });
+		int clothResolution = 40;
+		auto cloth = SpawnCloth(game, clothResolution, 3);
+		cloth->Initialize(glm::vec3(0.0f, scale + 0.5f, 0.0f), glm::vec3(1.0), glm::vec3(90, 0, 0));
 	}
 };
 
@@ -258,17 +252,7 @@ public:
 	void PopulateActors(GameInstance* game)  override
 	{
 		SpawnCameraAndLight(game);
-		SpawnInfinitePlane(game);
-
-		ModifyParameter(&Global::simParams.numSubsteps, 3);
-		ModifyParameter(&Global::simParams.numSubsteps, 8);
-		ModifyParameter(&Global::simParams.friction, 0.3f);
-
-		int clothResolution = 60;
-		auto cloth = SpawnCloth(game, clothResolution, 1);
-		cloth->Initialize(glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(1.0), glm::vec3(-15, 10, 10));
-
-		auto clothObj = cloth->GetComponent<VtClothObjectGPU>();
+		SpawnDescription(game, VtHeadlessScene::Find("SelfCollision"));
 	}
 };
 
@@ -280,36 +264,7 @@ public:
 	void PopulateActors(GameInstance* game)  override
 	{
 		SpawnCameraAndLight(game);
-		SpawnInfinitePlane(game);
-
-		ModifyParameter(&Global::simParams.friction, 0.6f);
-		ModifyParameter(&Global::simParams.numSubsteps, 5);
-		ModifyParameter(&Global::simParams.numIterations, 5);
-
-		auto sphere = SpawnSphere(game);
-		float radius = 0.5f;
-		sphere->Initialize(glm::vec3(0, radius, 0), glm::vec3(radius));
-
-		game->animationUpdate.Register([sphere, game, radius]() {
-			float time = Timer::physicsFrameCount() * Timer::fixedDeltaTime() - 0.5f;
-			if (time > 0)
-			{
-				sphere->transform->position = glm::vec3(sin(time), radius, 0);
-			}
-
-			if ((int)time % 4 > 1)
-			{
-				sphere->transform->rotation = glm::vec3(0, -time * 180, 0);
-			}
-			else
-			{
-				sphere->transform->rotation = glm::vec3(0, time * 180, 0);
-			}
-			});
-
-		int clothResolution = 64;
-		auto cloth = SpawnCloth(game, clothResolution, 2);
-		cloth->Initialize(glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(1.0), glm::vec3(90, 0, 0));
+		SpawnDescription(game, VtHeadlessScene::Find("Friction"));
 	}
 };
 
@@ -321,33 +276,7 @@ public:
 	void PopulateActors(GameInstance* game)  override
 	{
 		SpawnCameraAndLight(game);
-		SpawnInfinitePlane(game);
-
-		ModifyParameter(&Global::simParams.friction, 0.6f);
-		ModifyParameter(&Global::simParams.numSubsteps, 5);
-		ModifyParameter(&Global::simParams.numIterations, 5);
-
-		auto cube = SpawnColoredCube(game);
-		float radius = 1.0f;
-		cube->Initialize(glm::vec3(0, 0.5 * radius, 0), glm::vec3(radius));
-
-		auto solverActor = game->CreateActor("ClothSolver");
-		auto solver = make_shared<VtClothSolverGPU>();
-		solverActor->AddComponent(solver);
-
-		int clothResolution = 64;
-		{
-			auto cloth = SpawnCloth(game, clothResolution, 1, solver);
-			cloth->Initialize(glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(1.0), glm::vec3(90, 0, 0));
-		}
-		{
-			auto cloth = SpawnCloth(game, clothResolution, 2, solver);
-			cloth->Initialize(glm::vec3(0.0f, 1.8f, 1.0f), glm::vec3(1.0), glm::vec3(90, 0, 0));
-		}
-		{
-			auto cloth = SpawnCloth(game, clothResolution, 3, solver);
-			cloth->Initialize(glm::vec3(0.0f, 2.1f, 1.0f), glm::vec3(1.0), glm::vec3(90, 0, 0));
-		}
+		SpawnDescription(game, VtHeadlessScene::Find("Multiple"));
 	}
 };
 
@@ -359,18 +288,7 @@ public:
 	void PopulateActors(GameInstance* game)  override
 	{
 		SpawnCameraAndLight(game);
-		SpawnInfinitePlane(game);
-
-		ModifyParameter(&Global::simParams.numSubsteps, 10);
-		ModifyParameter(&Global::simParams.numIterations, 10);
-
-		auto sphere = SpawnSphere(game);
-		float radius = 0.6f;
-		sphere->Initialize(glm::vec3(0, radius, 0), glm::vec3(radius));
-
-		int clothResolution = 200;
-		auto cloth = SpawnCloth(game, clothResolution, 2);
-		cloth->Initialize(glm::vec3(0.0f, 1.5f, 1.0f), glm::vec3(1.0), glm::vec3(90, 0, 0));
+		SpawnDescription(game, VtHeadlessScene::Find("HD"));
 	}
 };
 
@@ -405,8 +323,61 @@ public:
 	}
 };
 
-int main()
+class SceneClothPlayback : public Scene
+{
+public:
+	// path is a bake of the description called sceneName, e.g. velvet_headless --scene Multiple --bake cloth.vtc
+	SceneClothPlayback(const string& path, const string& sceneName) : _path(path), _sceneName(sceneName)
+	{
+		name = "Cloth / Playback";
+	}
+
+	void PopulateActors(GameInstance* game)  override
+	{
+		SpawnCameraAndLight(game);
+		SpawnPlayback(game, VtHeadlessScene::Find(_sceneName), _path);
+	}
+private:
+	string _path;
+	string _sceneName;
+};
+
+// usage: Velvet [--playback cloth.vtc] [--scene Multiple]
+// --playback starts on the playback scene, which plays velvet_bake.vtc (Bake Cache of Cloth / Multiple Object) otherwise.
+int main(int argc, char* argv[])
 {
+	string playbackPath = "velvet_bake.vtc";
+	string playbackScene = "Multiple";
+	bool startPlayback = false;
+	for (int i = 1; i < argc; i += 2)
+	{
+		string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			fmt::print("Error(Main): Missing value for argument [{}].\n", arg);
+			return 1;
+		}
+		if (arg == "--playback")
+		{
+			playbackPath = argv[i + 1];
+			startPlayback = true;
+		}
+		else if (arg == "--scene")
+		{
+			playbackScene = argv[i + 1];
+		}
+		else
+		{
+			fmt::print("Error(Main): Unknown argument [{}].\n", arg);
+			return 1;
+		}
+	}
+	if (VtHeadlessScene::Find(playbackScene).name.empty())
+	{
+		fmt::print("Error(Main): Unknown scene [{}].\n", playbackScene);
+		return 1;
+	}
+
 	//=====================================
 	// 1. Create graphics
 	//=====================================
@@ -425,10 +396,12 @@ int main()
 		make_shared<SceneClothMultiple>(),
 		make_shared<SceneClothHD>(),
 		make_shared<SceneClothSwirl>(),
+		make_shared<SceneClothMeshCollision>(),
+		make_shared<SceneClothPlayback>(playbackPath, playbackScene),
 		//make_shared<SceneColoredCubes>(),
 		//make_shared<ScenePremitiveRendering>(),
 	};
-	engine->SetScenes(scenes);
+	engine->SetScenes(scenes, startPlayback ? (unsigned int)scenes.size() - 1 : 0);
 
 	//=====================================
 	// 3. Run graphics
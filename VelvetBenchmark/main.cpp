@@ -0,0 +1,275 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+#include <fmt/format.h>
+#include <fmt/os.h>
+
+#include "Global.hpp"
+#include "Timer.hpp"
+#include "VtHeadlessScene.hpp"
+
+using namespace VRThreads;
+
+// Runs the headless scenes over a matrix of settings and reports per-phase solver times.
+// usage: velvet_benchmark [--scenes Attach,SelfCollision,Multiple,HD] [--resolutions 0,64,128] [--threads 1,0]
+//                         [--substeps 0] [--iterations 0] [--frames 120] [--warmup 20] [--json out.json] [--csv out.csv]
+// A value of 0 keeps the default of the scene (resolution, substeps, iterations) or uses all cores (threads).
+
+struct BenchmarkArgs
+{
+	vector<string> scenes = { "Attach", "SelfCollision", "Multiple", "HD" };
+	vector<int> resolutions = { 0 };
+	vector<int> threads = { 1, 0 };
+	vector<int> substeps = { 0 };
+	vector<int> iterations = { 0 };
+	int frames = 120;
+	int warmup = 20;
+	string json;
+	string csv;
+};
+
+// Reported phases and the Timer labels they sum up
+struct BenchmarkPhase
+{
+	string name;
+	vector<string> labels;
+};
+
+const vector<BenchmarkPhase> k_phases = {
+	{ "predict", { "Solver_Predict" } },
+	{ "stretch", { "Solver_SolveStretch" } },
+	{ "bend", { "Solver_SolveBending" } },
+	{ "applyDeltas", { "Solver_ApplyDeltas" } },
+	{ "attach", { "Solver_SolveAttach" } },
+	{ "collideSDF", { "Solver_CollideSDFs" } },
+	{ "hash", { "Solver_HashCache" } },
+	{ "collideParticles", { "Solver_CollideParticles" } },
+	{ "finalize", { "Solver_Finalize" } },
+	{ "normals", { "Solver_UpdateNormals" } },
+	{ "total", { "Solver_Total" } },
+};
+
+struct BenchmarkResult
+{
+	string scene;
+	int resolution = 0;
+	int particles = 0;
+	int threads = 0;
+	int substeps = 0;
+	int iterations = 0;
+	int frames = 0;
+	vector<double> phaseTimes; // ms per frame, same order as k_phases
+};
+
+vector<string> Split(const string& value)
+{
+	vector<string> result;
+	stringstream stream(value);
+	string item;
+	while (getline(stream, item, ','))
+	{
+		if (!item.empty()) result.push_back(item);
+	}
+	return result;
+}
+
+// The whole value has to be a non-negative integer
+bool ParseInt(const string& arg, const string& value, int& result)
+{
+	char* end = nullptr;
+	errno = 0;
+	long number = strtol(value.c_str(), &end, 10);
+	if (end == value.c_str() || *end != '\0' || errno == ERANGE || number < 0 || number > INT_MAX)
+	{
+		fmt::print("Error(Benchmark): Invalid value [{}] for argument [{}], expected a non-negative integer.\n", value, arg);
+		return false;
+	}
+	result = (int)number;
+	return true;
+}
+
+bool SplitInt(const string& arg, const string& value, vector<int>& result)
+{
+	result.clear();
+	for (const auto& item : Split(value))
+	{
+		int number;
+		if (!ParseInt(arg, item, number)) return false;
+		result.push_back(number);
+	}
+	return true;
+}
+
+bool ParseArgs(int argc, char* argv[], BenchmarkArgs& args)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			fmt::print("Error(Benchmark): Missing value for argument [{}].\n", arg);
+			return false;
+		}
+		string value = argv[++i];
+
+		bool valid = true;
+		if (arg == "--scenes") args.scenes = Split(value);
+		else if (arg == "--resolutions") valid = SplitInt(arg, value, args.resolutions);
+		else if (arg == "--threads") valid = SplitInt(arg, value, args.threads);
+		else if (arg == "--substeps") valid = SplitInt(arg, value, args.substeps);
+		else if (arg == "--iterations") valid = SplitInt(arg, value, args.iterations);
+		else if (arg == "--frames") valid = ParseInt(arg, value, args.frames);
+		else if (arg == "--warmup") valid = ParseInt(arg, value, args.warmup);
+		else if (arg == "--json") args.json = value;
+		else if (arg == "--csv") args.csv = value;
+		else
+		{
+			fmt::print("Error(Benchmark): Unknown argument [{}].\n", arg);
+			return false;
+		}
+		if (!valid) return false;
+	}
+	return true;
+}
+
+BenchmarkResult RunBenchmark(const VtHeadlessScene& scene, int threads, int substeps, int iterations, const BenchmarkArgs& args)
+{
+	// every run starts from the default parameters
+	static const VtSimParams defaultParams = Global::simParams;
+	Global::simParams = defaultParams;
+	scene.ApplyParams(Global::simParams);
+	Global::simParams.numCpuThreads = threads;
+	if (substeps > 0) Global::simParams.numSubsteps = substeps;
+	if (iterations > 0) Global::simParams.numIterations = iterations;
+
+	VtHeadlessSimulation simulation;
+	simulation.Initialize(scene);
+
+	BenchmarkResult result;
+	result.scene = scene.name;
+	result.resolution = scene.cloths[0].resolution;
+	result.particles = simulation.numParticles();
+	result.threads = simulation.threadPool->numThreads();
+	result.substeps = Global::simParams.numSubsteps;
+	result.iterations = Global::simParams.numIterations;
+	result.frames = args.frames;
+	result.phaseTimes.assign(k_phases.size(), 0.0);
+
+	vector<vector<TimerId>> phaseIds(k_phases.size());
+	for (int p = 0; p < k_phases.size(); p++)
+	{
+		for (const auto& label : k_phases[p].labels) phaseIds[p].push_back(Timer::Intern(label));
+	}
+
+	for (int frame = 0; frame < args.warmup; frame++)
+	{
+		simulation.Step();
+	}
+
+	for (int frame = 0; frame < args.frames; frame++)
+	{
+		simulation.Step();
+		for (int p = 0; p < k_phases.size(); p++)
+		{
+			for (auto id : phaseIds[p])
+			{
+				result.phaseTimes[p] += Timer::GetTimer(id, Timer::frameCount()) * 1000;
+			}
+		}
+	}
+
+	for (auto& time : result.phaseTimes)
+	{
+		time /= max(1, args.frames);
+	}
+	return result;
+}
+
+void WriteJson(const string& path, const vector<BenchmarkResult>& results)
+{
+	auto out = fmt::output_file(path);
+	out.print("{{\n  \"unit\": \"ms per frame\",\n  \"results\": [\n");
+	for (int i = 0; i < results.size(); i++)
+	{
+		const auto& r = results[i];
+		out.print("    {{ \"scene\": \"{}\", \"resolution\": {}, \"particles\": {}, \"threads\": {}, \"substeps\": {}, \"iterations\": {}, \"frames\": {}, \"phases\": {{ ",
+			r.scene, r.resolution, r.particles, r.threads, r.substeps, r.iterations, r.frames);
+		for (int p = 0; p < k_phases.size(); p++)
+		{
+			out.print("\"{}\": {:.4f}{}", k_phases[p].name, r.phaseTimes[p], p + 1 < k_phases.size() ? ", " : "");
+		}
+		out.print(" }} }}{}\n", i + 1 < results.size() ? "," : "");
+	}
+	out.print("  ]\n}}\n");
+}
+
+void WriteCsv(const string& path, const vector<BenchmarkResult>& results)
+{
+	auto out = fmt::output_file(path);
+	out.print("scene,resolution,particles,threads,substeps,iterations,frames");
+	for (const auto& phase : k_phases) out.print(",{}", phase.name);
+	out.print("\n");
+
+	for (const auto& r : results)
+	{
+		out.print("{},{},{},{},{},{},{}", r.scene, r.resolution, r.particles, r.threads, r.substeps, r.iterations, r.frames);
+		for (auto time : r.phaseTimes) out.print(",{:.4f}", time);
+		out.print("\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkArgs args;
+	if (!ParseArgs(argc, argv, args)) return 1;
+
+	// Timer provides the fixed time step to the solver and collects the phase times
+	Timer timer;
+
+	vector<BenchmarkResult> results;
+	for (int resolution : args.resolutions)
+	{
+		auto scenes = VtHeadlessScene::All(resolution);
+		for (const auto& name : args.scenes)
+		{
+			auto it = find_if(scenes.begin(), scenes.end(), [&name](const VtHeadlessScene& s) { return s.name == name; });
+			if (it == scenes.end())
+			{
+				fmt::print("Warning(Benchmark): Scene [{}] not found.\n", name);
+				continue;
+			}
+
+			for (int threads : args.threads)
+			{
+				for (int substeps : args.substeps)
+				{
+					for (int iterations : args.iterations)
+					{
+						auto result = RunBenchmark(*it, threads, substeps, iterations, args);
+						fmt::print("Info(Benchmark): {} res {} threads {} substeps {} iterations {}: {:.3f} ms per frame\n", result.scene,
+							result.resolution, result.threads, result.substeps, result.iterations, result.phaseTimes.back());
+						results.push_back(result);
+					}
+				}
+			}
+		}
+	}
+
+	if (!args.json.empty())
+	{
+		WriteJson(args.json, results);
+		fmt::print("Info(Benchmark): Results written to [{}]\n", args.json);
+	}
+	if (!args.csv.empty())
+	{
+		WriteCsv(args.csv, results);
+		fmt::print("Info(Benchmark): Results written to [{}]\n", args.csv);
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+#include <fmt/format.h>
+#include <fmt/os.h>
+
+#include "Global.hpp"
+#include "Timer.hpp"
+#include "VtHeadlessScene.hpp"
+#include "VtClothCache.hpp"
+
+using namespace VRThreads;
+
+// Runs the physics of a scene for a fixed number of frames without a window or GL context.
+// usage: velvet_headless [--scene Attach] [--frames 300] [--threads 0] [--output positions.obj] [--timings timings.csv] [--trace trace.json] [--list]
+//                        [--bake cloth.vtc] [--bake-encoding raw|quantized|delta] [--bake-step 0.0001] [--bake-stride 1] [--bake-positions-only]
+// A bake holds all cloths of the scene, in the order of the scene.
+
+struct HeadlessArgs
+{
+	string scene = "Attach";
+	int frames = 300;
+	int threads = 0;
+	string output;
+	string timings;
+	string trace;
+	bool list = false;
+
+	string bake;
+	VtCacheEncoding bakeEncoding = VtCacheEncoding::Delta;
+	float bakeStep = 1e-4f;
+	int bakeStride = 1;
+	bool bakeNormals = true;
+};
+
+// The whole value has to be a number of at least minValue
+bool ParseInt(const string& arg, const char* value, int minValue, int& result)
+{
+	char* end = nullptr;
+	errno = 0;
+	long number = strtol(value, &end, 10);
+	if (end == value || *end != '\0' || errno == ERANGE || number < minValue || number > INT_MAX)
+	{
+		fmt::print("Error(Headless): Invalid value [{}] for argument [{}], expected an integer of at least {}.\n", value, arg, minValue);
+		return false;
+	}
+	result = (int)number;
+	return true;
+}
+
+bool ParsePositiveFloat(const string& arg, const char* value, float& result)
+{
+	char* end = nullptr;
+	errno = 0;
+	float number = strtof(value, &end);
+	if (end == value || *end != '\0' || errno == ERANGE || !(number > 0))
+	{
+		fmt::print("Error(Headless): Invalid value [{}] for argument [{}], expected a positive number.\n", value, arg);
+		return false;
+	}
+	result = number;
+	return true;
+}
+
+bool ParseArgs(int argc, char* argv[], HeadlessArgs& args)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--list")
+		{
+			args.list = true;
+		}
+		else if (arg == "--bake-positions-only")
+		{
+			args.bakeNormals = false;
+		}
+		else if (arg == "--scene" && hasValue)
+		{
+			args.scene = argv[++i];
+		}
+		else if (arg == "--frames" && hasValue)
+		{
+			if (!ParseInt(arg, argv[++i], 0, args.frames)) return false;
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			if (!ParseInt(arg, argv[++i], 0, args.threads)) return false;
+		}
+		else if (arg == "--output" && hasValue)
+		{
+			args.output = argv[++i];
+		}
+		else if (arg == "--timings" && hasValue)
+		{
+			args.timings = argv[++i];
+		}
+		else if (arg == "--trace" && hasValue)
+		{
+			args.trace = argv[++i];
+		}
+		else if (arg == "--bake" && hasValue)
+		{
+			args.bake = argv[++i];
+		}
+		else if (arg == "--bake-encoding" && hasValue)
+		{
+			string encoding = argv[++i];
+			if (encoding == "raw") args.bakeEncoding = VtCacheEncoding::Raw;
+			else if (encoding == "quantized") args.bakeEncoding = VtCacheEncoding::Quantized;
+			else if (encoding == "delta") args.bakeEncoding = VtCacheEncoding::Delta;
+			else
+			{
+				fmt::print("Error(Headless): Unknown bake encoding [{}].\n", encoding);
+				return false;
+			}
+		}
+		else if (arg == "--bake-step" && hasValue)
+		{
+			if (!ParsePositiveFloat(arg, argv[++i], args.bakeStep)) return false;
+		}
+		else if (arg == "--bake-stride" && hasValue)
+		{
+			if (!ParseInt(arg, argv[++i], 1, args.bakeStride)) return false;
+		}
+		else
+		{
+			fmt::print("Error(Headless): Unknown or incomplete argument [{}].\n", arg);
+			return false;
+		}
+	}
+	return true;
+}
+
+void WriteObj(const string& path, const vector<shared_ptr<VtClothSolverCPU>>& solvers, const vector<VtClothGeometry>& geometries)
+{
+	auto out = fmt::output_file(path);
+	unsigned int firstVertex = 1;
+	for (int c = 0; c < solvers.size(); c++)
+	{
+		const auto& positions = solvers[c]->m_positions;
+		const auto& normals = solvers[c]->m_normals;
+		const auto& indices = geometries[c].indices;
+
+		out.print("o cloth{}\n", c);
+		for (const auto& p : positions) out.print("v {} {} {}\n", p.x, p.y, p.z);
+		for (const auto& n : normals) out.print("vn {} {} {}\n", n.x, n.y, n.z);
+		for (int i = 0; i < indices.size(); i += 3)
+		{
+			unsigned int a = indices[i] + firstVertex, b = indices[i + 1] + firstVertex, d = indices[i + 2] + firstVertex;
+			out.print("f {}//{} {}//{} {}//{}\n", a, a, b, b, d, d);
+		}
+		firstVertex += (unsigned int)positions.size();
+	}
+}
+
+// Concatenates the cloths, so the cache matches the merged buffers of the GPU solver
+void GatherFrame(const vector<shared_ptr<VtClothSolverCPU>>& solvers, vector<glm::vec3>& positions, vector<glm::vec3>& normals)
+{
+	positions.clear();
+	normals.clear();
+	for (const auto& solver : solvers)
+	{
+		positions.insert(positions.end(), solver->m_positions.begin(), solver->m_positions.end());
+		normals.insert(normals.end(), solver->m_normals.begin(), solver->m_normals.end());
+	}
+}
+
+bool OpenBake(const HeadlessArgs& args, const VtHeadlessSimulation& simulation, VtClothCacheWriter& writer)
+{
+	vector<unsigned int> indices;
+	unsigned int firstVertex = 0;
+	for (int c = 0; c < simulation.solvers.size(); c++)
+	{
+		for (auto index : simulation.geometries[c].indices) indices.push_back(index + firstVertex);
+		firstVertex += (unsigned int)simulation.solvers[c]->m_positions.size();
+	}
+	float frameRate = 1.0f / (Timer::fixedDeltaTime() * args.bakeStride);
+	return writer.Open(args.bake, indices, (int)firstVertex, frameRate, args.bakeEncoding, args.bakeNormals, args.bakeStep);
+}
+
+int main(int argc, char* argv[])
+{
+	HeadlessArgs args;
+	if (!ParseArgs(argc, argv, args)) return 1;
+
+	auto scenes = VtHeadlessScene::All();
+	if (args.list)
+	{
+		for (const auto& s : scenes) fmt::print("{}\n", s.name);
+		return 0;
+	}
+
+	auto it = find_if(scenes.begin(), scenes.end(), [&args](const VtHeadlessScene& s) { return s.name == args.scene; });
+	if (it == scenes.end())
+	{
+		fmt::print("Error(Headless): Scene [{}] not found, use --list to show all scenes.\n", args.scene);
+		return 1;
+	}
+	auto& scene = *it;
+
+	// Timer provides the fixed time step to the solver
+	Timer timer;
+	Timer::EnableTracing(!args.trace.empty());
+
+	Global::simParams.numCpuThreads = args.threads;
+	scene.ApplyParams(Global::simParams);
+
+	VtHeadlessSimulation simulation;
+	simulation.Initialize(scene);
+
+	fmt::print("Info(Headless): Scene [{}], {} frames, {} cloths\n", scene.name, args.frames, simulation.solvers.size());
+
+	VtClothCacheWriter bakeWriter;
+	if (!args.bake.empty() && !OpenBake(args, simulation, bakeWriter)) return 1;
+	vector<glm::vec3> bakePositions, bakeNormals;
+
+	vector<double> frameTimes;
+	double totalTime = 0;
+	for (int frame = 1; frame <= args.frames; frame++)
+	{
+		double start = Timer::CurrentTime();
+		simulation.Step();
+		double elapsed = Timer::CurrentTime() - start;
+		frameTimes.push_back(elapsed * 1000);
+		totalTime += elapsed;
+
+		if (bakeWriter.isOpen() && frame % args.bakeStride == 0)
+		{
+			GatherFrame(simulation.solvers, bakePositions, bakeNormals);
+			bakeWriter.WriteFrame(bakePositions, bakeNormals);
+		}
+	}
+
+	fmt::print("Info(Headless): Simulated {} frames in {:.3f} s, {:.3f} ms per frame\n", args.frames, totalTime,
+		totalTime * 1000 / max(1, args.frames));
+
+	if (!args.output.empty())
+	{
+		WriteObj(args.output, simulation.solvers, simulation.geometries);
+		fmt::print("Info(Headless): Positions written to [{}]\n", args.output);
+	}
+
+	if (!args.timings.empty())
+	{
+		auto out = fmt::output_file(args.timings);
+		out.print("frame,ms\n");
+		for (int i = 0; i < frameTimes.size(); i++)
+		{
+			out.print("{},{:.4f}\n", i + 1, frameTimes[i]);
+		}
+		fmt::print("Info(Headless): Timings written to [{}]\n", args.timings);
+	}
+
+	if (!args.trace.empty())
+	{
+		Timer::WriteTrace(args.trace);
+	}
+
+	if (bakeWriter.isOpen() && !bakeWriter.Close()) return 1;
+	return 0;
+}
\ No newline at end of file